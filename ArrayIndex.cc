@@ -4,13 +4,45 @@
 // 20151023  Michael Kelsey
 // 20160217  Force sequential indices, overriding user setting
 // 20160224  Move destructor action to cleanup() function
+// 20261017  Check index range, for queries of absent objectIds
+// 20261017  Allocate from OS with selectable page policy (huge pages)
+// 20261017  Optional bit-packed chunks, sized from generated chunk range
 
 #include "ArrayIndex.hh"
+#include "PackedArray.hh"
+#include <iostream>
 
 
+ArrayIndex::ArrayIndex(int verbose)
+  : IndexTester("array",verbose), array(0), packedArray(0), packed(false),
+    packBits(0), arrayBytes(0), pagePolicy(SmallPages),
+    usedPolicy(SmallPages), typeName("array") {;}
+
+void ArrayIndex::setPagePolicy(PagePolicy policy) {
+  pagePolicy = policy;
+  updateName();
+}
+
+void ArrayIndex::setPacked(bool pack) {
+  packed = pack;
+  updateName();
+}
+
+void ArrayIndex::updateName() {
+  typeName = "array";
+  if (packed) typeName += "-packed";
+  if (pagePolicy != SmallPages) {
+    typeName += "-";
+    typeName += pagePolicyName(pagePolicy);
+  }
+  SetName(typeName.c_str());
+}
+
 void ArrayIndex::cleanup() {
-  delete[] array;
+  freePages(array ? (void*)array : (void*)packedArray, arrayBytes, usedPolicy);
   array = 0;
+  packedArray = 0;
+  arrayBytes = 0;
 }
 
 // Construct single massive array in memory
@@ -18,13 +50,83 @@ void ArrayIndex::cleanup() {
 void ArrayIndex::create(objectId_t asize) {
   SetIndexSpacing(1);			// Ensure that indices are dense
 
-  if (array) cleanup();			// Avoid memory leaks
-  if (asize>0) array = new chunkId_t[asize]();	// Fill with zeroes
+  if (array || packedArray) cleanup();	// Avoid memory leaks
+  if (asize == 0) return;
+
+  if (packed) {
+    chunkGen.reset();
+    packBits = PackedArray::bitsFor(chunkGen.maxChunk());
+    arrayBytes = PackedArray::wordsFor(asize, packBits)*sizeof(uint64_t);
+  } else {
+    arrayBytes = asize*sizeof(chunkId_t);
+  }
+
+  usedPolicy = pagePolicy;
+  void* storage = allocatePages(arrayBytes, usedPolicy);	// Zero filled
+  if (!storage) {
+    std::cerr << "ArrayIndex unable to allocate " << arrayBytes << " bytes"
+	      << std::endl;
+    arrayBytes = 0;
+    return;
+  }
+
+  if (packed) {				// Filling touches every page
+    packedArray = (uint64_t*)storage;
+    for (objectId_t i=0; i<asize; i++) {
+      PackedArray::set(packedArray, i, packBits, chunkGen.next());
+    }
+
+    if (verboseLevel>1) {
+      std::cout << "ArrayIndex packed " << asize << " chunks in " << packBits
+		<< " bits" << std::endl;
+    }
+    return;
+  }
+
+  array = (chunkId_t*)storage;
+
+  // Touch each page, as new[]() would have done to fill with zeroes
+  size_t page = pageSize(usedPolicy);
+  for (size_t i=0; i<arrayBytes; i+=page) ((volatile char*)array)[i] = 0;
+
+  if (verboseLevel>1 && usedPolicy != pagePolicy) {
+    std::cout << "ArrayIndex " << pagePolicyName(pagePolicy)
+	      << " not available, using " << pagePolicyName(usedPolicy)
+	      << std::endl;
+  }
 }
 
 
 // Access requested array element with existence check
 
 chunkId_t ArrayIndex::value(objectId_t index) {
-  return (array ? array[index] : 0xdeadbeef);
+  if (packedArray && index < tableSize)
+    return PackedArray::get(packedArray, index, packBits);
+
+  return ((array && index < tableSize) ? array[index] : 0xdeadbeef);
+}
+
+// Packed chunks are decoded together for the whole batch
+
+void ArrayIndex::values(const objectId_t* index, chunkId_t* chunk, size_t n) {
+  if (packedArray) {
+    PackedArray::gather(packedArray, packBits, tableSize, index, n, chunk,
+			0xdeadbeef);
+    return;
+  }
+
+  for (size_t i=0; i<n; i++) chunk[i] = value(index[i]);
+}
+
+
+// Append page policy actually used, and storage per entry
+
+void ArrayIndex::reportHeadings(std::ostream& csv) const {
+  csv << ", Pages, Chunk bits, Bytes/entry";
+}
+
+void ArrayIndex::reportColumns(std::ostream& csv) const {
+  csv << ", " << pagePolicyName(usedPolicy)
+      << ", " << (packedArray ? packBits : 8*sizeof(chunkId_t))
+      << ", " << (tableSize>0 ? (double)arrayBytes/tableSize : 0.);
 }
@@ -5,22 +5,44 @@
 //
 // 20151023  Michael Kelsey
 // 20160224  Move destructor action to cleanup() function
+// 20261017  Allocate from OS with selectable page policy (huge pages)
+// 20261017  Optional bit-packed chunks, sized from generated chunk range
 
 #include "IndexTester.hh"
+#include "ChunkGenerator.hh"
+#include "PageAlloc.hh"
+#include <string>
 
 
 class ArrayIndex : public IndexTester {
 public:
-  ArrayIndex(int verbose=0) : IndexTester("array",verbose), array(0) {;}
+  ArrayIndex(int verbose=0);
   virtual ~ArrayIndex() { cleanup(); }
 
+  void setPagePolicy(PagePolicy policy=SmallPages);	// Changes CSV name
+  void setPacked(bool pack=true);			// Changes CSV name
+
 protected:
   virtual void create(objectId_t asize);
   virtual chunkId_t value(objectId_t index);
+  virtual void values(const objectId_t* index, chunkId_t* chunk, size_t n);
   virtual void cleanup();
 
+  virtual void reportHeadings(std::ostream& csv) const;
+  virtual void reportColumns(std::ostream& csv) const;
+
+  void updateName();
+
 private:
   chunkId_t* array;
+  uint64_t* packedArray;		// Used instead of array if packing
+  bool packed;
+  unsigned packBits;
+  ChunkGenerator chunkGen;		// Chunks for packed array
+  size_t arrayBytes;
+  PagePolicy pagePolicy;		// Requested
+  PagePolicy usedPolicy;		// After any fallback
+  std::string typeName;
 };
 
 #endif	/* ARRAY_INDEX_HH */
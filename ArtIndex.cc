@@ -0,0 +1,361 @@
+// $Id$
+// ArtIndex.cc -- Exercise performance of adaptive radix tree (Leis et al.,
+// 2013) as lookup table, with path compression of shared key bytes.
+// Supports inserts, for incremental (bulk update) loading.
+//
+// 20261017  Michael Kelsey
+
+#include "ArtIndex.hh"
+#include <string.h>
+#include <fstream>
+#include <iostream>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+// Constructor and destructor
+
+ArtIndex::ArtIndex(int verbose)
+  : IndexTester("art",verbose), root(0), nKeys(0ULL) {
+  for (int t=0; t<nTypes; t++) nodeCount[t] = 0;
+}
+
+void ArtIndex::cleanup() {
+  freeNode(root);
+  root = 0;
+
+  nKeys = 0;
+  for (int t=0; t<nTypes; t++) nodeCount[t] = 0;
+}
+
+
+// Insert full range of keys, with clustered chunk assignments
+
+void ArtIndex::create(objectId_t asize) {
+  cleanup();				// Discard previous table
+  if (asize == 0) return;
+
+  chunkGen.reset();
+  for (objectId_t i=0; i<asize; i++) insert(i*indexStep, chunkGen.next());
+
+  if (verboseLevel>1) {
+    std::cout << " " << nKeys << " keys, nodes " << nodeCount[Type4] << " / "
+	      << nodeCount[Type16] << " / " << nodeCount[Type48] << " / "
+	      << nodeCount[Type256] << ", " << bytesPerEntry()
+	      << " bytes/entry" << std::endl;
+  }
+}
+
+
+// Bulk update from file of "objectId chunkId" lines
+
+void ArtIndex::update(const char* datafile) {
+  if (!datafile) return;
+
+  std::ifstream bulkfile(datafile);
+  if (!bulkfile) {
+    std::cerr << "ArtIndex::update " << datafile << " not found" << std::endl;
+    return;
+  }
+
+  objectId_t objID;
+  chunkId_t chunk;
+  while (bulkfile >> objID >> chunk) insert(objID, chunk);
+}
+
+
+// Walk down tree, splitting compressed paths where key differs
+
+void ArtIndex::insert(objectId_t key, chunkId_t chunk) {
+  if (!root) {
+    root = newPath(key, 0, chunk);
+    nKeys++;
+    return;
+  }
+
+  Node** ref = &root;
+  int depth = 0;
+  while (true) {
+    Node* n = *ref;
+
+    int p = prefixMismatch(n, key, depth);
+    if (p < n->prefixLen) {		// New parent for shared part of prefix
+      Node* parent = newNode(Type4);
+      parent->prefixLen = p;
+      memcpy(parent->prefix, n->prefix, p);
+
+      uint8_t oldByte = n->prefix[p];
+      n->prefixLen -= p+1;
+      memmove(n->prefix, n->prefix+p+1, n->prefixLen);
+
+      addChild(parent, oldByte, n);
+      addChild(parent, byteAt(key,depth+p), newPath(key, depth+p+1, chunk));
+      *ref = parent;
+      nKeys++;
+      return;
+    }
+
+    depth += n->prefixLen;
+    uint8_t byte = byteAt(key, depth);
+
+    Node** child = findChild(n, byte);
+    if (!child) {
+      addChild(*ref, byte, newPath(key, depth+1, chunk));
+      nKeys++;
+      return;
+    }
+
+    if (depth == keyBytes-1) {		// Key already present
+      *child = makeLeaf(chunk);
+      return;
+    }
+
+    ref = child;
+    depth++;
+  }
+}
+
+
+// Access requested key, checking compressed prefixes along the way
+
+chunkId_t ArtIndex::value(objectId_t index) {
+  Node* n = root;
+  int depth = 0;
+
+  while (n) {
+    if (isLeaf(n)) return leafValue(n);
+
+    if (n->prefixLen) {
+      if (prefixMismatch(n, index, depth) < n->prefixLen) return 0xdeadbeef;
+      depth += n->prefixLen;
+    }
+
+    Node** child = findChild(n, byteAt(index, depth++));
+    if (!child) return 0xdeadbeef;
+    n = *child;
+  }
+
+  return 0xdeadbeef;
+}
+
+
+// Position of first prefix byte not matching key (prefixLen if all match)
+
+int ArtIndex::prefixMismatch(const Node* n, objectId_t key, int depth) const {
+  int p = 0;
+  while (p < n->prefixLen && n->prefix[p] == byteAt(key, depth+p)) p++;
+  return p;
+}
+
+
+// Locate slot for child pointer, or null if not present
+
+ArtIndex::Node** ArtIndex::findChild(Node* n, uint8_t byte) const {
+  switch (n->type) {
+  case Type4: {
+    Node4* n4 = static_cast<Node4*>(n);
+    for (int i=0; i<n4->count; i++) {
+      if (n4->key[i] == byte) return &n4->child[i];
+    }
+  } break;
+  case Type16: {
+    Node16* n16 = static_cast<Node16*>(n);
+#ifdef __SSE2__
+    __m128i match = _mm_cmpeq_epi8(_mm_set1_epi8((char)byte),
+		   _mm_loadu_si128(reinterpret_cast<const __m128i*>(n16->key)));
+    unsigned bits = _mm_movemask_epi8(match) & ((1U << n16->count) - 1);
+    if (bits) return &n16->child[__builtin_ctz(bits)];
+#else
+    for (int i=0; i<n16->count; i++) {
+      if (n16->key[i] == byte) return &n16->child[i];
+    }
+#endif
+  } break;
+  case Type48: {
+    Node48* n48 = static_cast<Node48*>(n);
+    if (n48->index[byte]) return &n48->child[n48->index[byte]-1];
+  } break;
+  case Type256: {
+    Node256* n256 = static_cast<Node256*>(n);
+    if (n256->child[byte]) return &n256->child[byte];
+  } break;
+  default: break;
+  }
+
+  return 0;
+}
+
+
+// Add child to node, replacing node with next larger type if full
+
+void ArtIndex::addChild(Node*& ref, uint8_t byte, Node* child) {
+  Node* n = ref;
+
+  switch (n->type) {
+  case Type4: {
+    Node4* n4 = static_cast<Node4*>(n);
+    if (n4->count == 4) {
+      Node16* n16 = static_cast<Node16*>(newNode(Type16));
+      memcpy(n16, n4, sizeof(Node));
+      n16->type = Type16;
+      memcpy(n16->key, n4->key, 4);
+      memcpy(n16->child, n4->child, 4*sizeof(Node*));
+      delete n4;
+      nodeCount[Type4]--;
+      ref = n16;
+      addChild(ref, byte, child);
+      return;
+    }
+
+    int pos = n4->count;
+    for (; pos>0 && n4->key[pos-1] > byte; pos--) {
+      n4->key[pos] = n4->key[pos-1];
+      n4->child[pos] = n4->child[pos-1];
+    }
+    n4->key[pos] = byte;
+    n4->child[pos] = child;
+    n4->count++;
+  } break;
+  case Type16: {
+    Node16* n16 = static_cast<Node16*>(n);
+    if (n16->count == 16) {
+      Node48* n48 = static_cast<Node48*>(newNode(Type48));
+      memcpy(n48, n16, sizeof(Node));
+      n48->type = Type48;
+      for (int i=0; i<16; i++) {
+	n48->child[i] = n16->child[i];
+	n48->index[n16->key[i]] = i+1;
+      }
+      delete n16;
+      nodeCount[Type16]--;
+      ref = n48;
+      addChild(ref, byte, child);
+      return;
+    }
+
+    int pos = n16->count;
+    for (; pos>0 && n16->key[pos-1] > byte; pos--) {
+      n16->key[pos] = n16->key[pos-1];
+      n16->child[pos] = n16->child[pos-1];
+    }
+    n16->key[pos] = byte;
+    n16->child[pos] = child;
+    n16->count++;
+  } break;
+  case Type48: {
+    Node48* n48 = static_cast<Node48*>(n);
+    if (n48->count == 48) {
+      Node256* n256 = static_cast<Node256*>(newNode(Type256));
+      memcpy(n256, n48, sizeof(Node));
+      n256->type = Type256;
+      for (int b=0; b<256; b++) {
+	if (n48->index[b]) n256->child[b] = n48->child[n48->index[b]-1];
+      }
+      delete n48;
+      nodeCount[Type48]--;
+      ref = n256;
+      addChild(ref, byte, child);
+      return;
+    }
+
+    n48->child[n48->count] = child;	// Slots are filled in order
+    n48->index[byte] = ++n48->count;
+  } break;
+  case Type256: {
+    Node256* n256 = static_cast<Node256*>(n);
+    n256->child[byte] = child;
+    n256->count++;
+  } break;
+  default: break;
+  }
+}
+
+
+// Remainder of key below depth, as a node holding the rest in its prefix
+
+ArtIndex::Node* ArtIndex::newPath(objectId_t key, int depth, chunkId_t chunk) {
+  if (depth >= keyBytes) return makeLeaf(chunk);
+
+  Node* n = newNode(Type4);
+  n->prefixLen = keyBytes-1-depth;
+  for (int i=0; i<n->prefixLen; i++) n->prefix[i] = byteAt(key, depth+i);
+
+  addChild(n, byteAt(key, keyBytes-1), makeLeaf(chunk));
+  return n;
+}
+
+
+// Allocate zero-filled node of requested type
+
+ArtIndex::Node* ArtIndex::newNode(NodeType type) {
+  Node* n = 0;
+  switch (type) {
+  case Type4:   n = new Node4();   break;
+  case Type16:  n = new Node16();  break;
+  case Type48:  n = new Node48();  break;
+  case Type256: n = new Node256(); break;
+  default: return 0;
+  }
+
+  n->type = type;
+  nodeCount[type]++;
+  return n;
+}
+
+
+// Delete node and all of its children
+
+void ArtIndex::freeNode(Node* n) {
+  if (!n || isLeaf(n)) return;
+
+  switch (n->type) {
+  case Type4: {
+    Node4* n4 = static_cast<Node4*>(n);
+    for (int i=0; i<n4->count; i++) freeNode(n4->child[i]);
+    delete n4;
+  } break;
+  case Type16: {
+    Node16* n16 = static_cast<Node16*>(n);
+    for (int i=0; i<n16->count; i++) freeNode(n16->child[i]);
+    delete n16;
+  } break;
+  case Type48: {
+    Node48* n48 = static_cast<Node48*>(n);
+    for (int i=0; i<n48->count; i++) freeNode(n48->child[i]);
+    delete n48;
+  } break;
+  case Type256: {
+    Node256* n256 = static_cast<Node256*>(n);
+    for (int b=0; b<256; b++) freeNode(n256->child[b]);
+    delete n256;
+  } break;
+  default: break;
+  }
+}
+
+
+// Memory use of all nodes (leaves take no space)
+
+double ArtIndex::bytesPerEntry() const {
+  if (nKeys == 0) return 0.;
+
+  double bytes = nodeCount[Type4]*sizeof(Node4)
+    + nodeCount[Type16]*sizeof(Node16) + nodeCount[Type48]*sizeof(Node48)
+    + nodeCount[Type256]*sizeof(Node256);
+
+  return bytes/nKeys;
+}
+
+
+// Append node counts and memory use
+
+void ArtIndex::reportHeadings(std::ostream& csv) const {
+  csv << ", Node4, Node16, Node48, Node256, Bytes/entry";
+}
+
+void ArtIndex::reportColumns(std::ostream& csv) const {
+  csv << ", " << nodeCount[Type4] << ", " << nodeCount[Type16]
+      << ", " << nodeCount[Type48] << ", " << nodeCount[Type256]
+      << ", " << bytesPerEntry();
+}
@@ -0,0 +1,91 @@
+#ifndef ART_INDEX_HH
+#define ART_INDEX_HH 1
+// $Id$
+// ArtIndex.hh -- Exercise performance of adaptive radix tree (Leis et al.,
+// 2013) as lookup table, with path compression of shared key bytes.
+// Supports inserts, for incremental (bulk update) loading.
+//
+// 20261017  Michael Kelsey
+
+#include "IndexTester.hh"
+#include "ChunkGenerator.hh"
+#include <stdint.h>
+
+
+class ArtIndex : public IndexTester {
+public:
+  ArtIndex(int verbose=0);
+  virtual ~ArtIndex() { cleanup(); }
+
+  void insert(objectId_t key, chunkId_t chunk);	// Replaces existing value
+
+  double bytesPerEntry() const;
+
+protected:
+  virtual void create(objectId_t asize);
+  virtual void update(const char* datafile);
+  virtual chunkId_t value(objectId_t index);
+  virtual void cleanup();
+
+  virtual void reportHeadings(std::ostream& csv) const;
+  virtual void reportColumns(std::ostream& csv) const;
+
+  // Keys are big-endian bytes of objectId, all the same length, so
+  // leaves are only found after the last byte
+  static const int keyBytes = sizeof(objectId_t);
+  static const int maxPrefix = keyBytes-1;
+
+  enum NodeType { Type4, Type16, Type48, Type256, nTypes };
+
+  struct Node {
+    uint8_t type;
+    uint8_t prefixLen;			// Key bytes skipped by this node
+    uint16_t count;			// Number of children
+    uint8_t prefix[maxPrefix];
+  };
+
+  struct Node4 : public Node {		// Keys in sorted order
+    uint8_t key[4];
+    Node* child[4];
+  };
+
+  struct Node16 : public Node {		// Keys in sorted order
+    uint8_t key[16];
+    Node* child[16];
+  };
+
+  struct Node48 : public Node {		// Index is slot+1, zero if absent
+    uint8_t index[256];
+    Node* child[48];
+  };
+
+  struct Node256 : public Node {
+    Node* child[256];
+  };
+
+  static uint8_t byteAt(objectId_t key, int depth) {
+    return (uint8_t)(key >> (8*(keyBytes-1-depth)));
+  }
+
+  // Leaves are tagged pointers holding chunk number, with no allocation
+  static bool isLeaf(const Node* n) { return ((uintptr_t)n & 1); }
+  static Node* makeLeaf(chunkId_t c) { return (Node*)(((uintptr_t)c<<1)|1); }
+  static chunkId_t leafValue(const Node* n) { return (uintptr_t)n >> 1; }
+
+  int prefixMismatch(const Node* n, objectId_t key, int depth) const;
+  Node** findChild(Node* n, uint8_t byte) const;
+  void addChild(Node*& ref, uint8_t byte, Node* child);	// Grows if full
+  Node* newPath(objectId_t key, int depth, chunkId_t chunk);
+
+  Node* newNode(NodeType type);
+  void freeNode(Node* n);
+
+private:
+  Node* root;
+  objectId_t nKeys;
+  objectId_t nodeCount[nTypes];
+
+  ChunkGenerator chunkGen;
+};
+
+#endif	/* ART_INDEX_HH */
@@ -0,0 +1,215 @@
+// $Id$
+// BTreeIndex.cc -- Exercise performance of static (bulk-loaded, read-only)
+// B+ tree with cache-line nodes as lookup table.  Number of keys per node
+// is a template parameter, instantiated for 8 (one 64-byte cache line)
+// and 16 (two cache lines).
+//
+// 20261017  Michael Kelsey
+// 20261017  Select page policy; name CSV output by configuration
+// 20261017  Report weaker of tree and chunk page policies
+// 20261017  Reject largest objectId, reserved for padding
+
+#include "BTreeIndex.hh"
+#include <algorithm>
+#include <iostream>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+
+// Constructor and destructor
+
+template <int B>
+BTreeIndex<B>::BTreeIndex(int verbose)
+  : IndexTester(B==8 ? "btree8" : "btree16", verbose), prefetch(false),
+    pagePolicy(HugeTHP), treePolicy(HugeTHP), chunkPolicy(HugeTHP),
+    nKeys(0ULL), tree(0), treeBytes(0), chunks(0), chunkBytes(0) {
+  updateName();
+}
+
+
+// Configuration; CSV name is changed to match
+
+template <int B>
+void BTreeIndex<B>::setPrefetch(bool pf) {
+  prefetch = pf;
+  updateName();
+}
+
+template <int B>
+void BTreeIndex<B>::setPagePolicy(PagePolicy policy) {
+  pagePolicy = policy;
+  updateName();
+}
+
+template <int B>
+void BTreeIndex<B>::updateName() {
+  typeName = (B==8) ? "btree8" : "btree16";
+  if (prefetch) typeName += "-prefetch";
+  if (pagePolicy != HugeTHP) {
+    typeName += "-";
+    typeName += pagePolicyName(pagePolicy);
+  }
+
+  SetName(typeName.c_str());
+}
+
+template <int B>
+void BTreeIndex<B>::cleanup() {
+  freePages(tree, treeBytes, treePolicy);
+  tree = 0;
+  treeBytes = 0;
+  freePages(chunks, chunkBytes, chunkPolicy);
+  chunks = 0;
+  chunkBytes = 0;
+
+  layerStart.clear();
+  layerNodes.clear();
+  nKeys = 0;
+}
+
+
+// Populate tree from sorted keys, all values zero
+
+template <int B>
+void BTreeIndex<B>::create(objectId_t asize) {
+  if (tree) cleanup();			// Avoid memory leaks
+  if (asize == 0) return;
+
+  nKeys = asize;
+
+  // Each layer has one key per child in the layer below (except first)
+  objectId_t nodes = (nKeys + B-1) / B;
+  layerNodes.push_back(nodes);
+  while (nodes > 1) {
+    nodes = (nodes + B) / (B+1);
+    layerNodes.push_back(nodes);
+  }
+
+  layerStart.resize(layerNodes.size());
+  objectId_t start = 0;
+  for (int h=layerNodes.size()-1; h>=0; h--) {
+    layerStart[h] = start;
+    start += layerNodes[h];
+  }
+
+  treeBytes = start*B*sizeof(objectId_t);
+  chunkBytes = layerNodes[0]*B*sizeof(chunkId_t);
+  treePolicy = chunkPolicy = pagePolicy;
+  tree = (objectId_t*)allocatePages(treeBytes, treePolicy);
+  chunks = (chunkId_t*)allocatePages(chunkBytes, chunkPolicy);  // Zero filled
+  if (!tree || !chunks) {
+    std::cerr << "BTreeIndex unable to allocate " << treeBytes << " bytes"
+	      << std::endl;
+    cleanup();
+    return;
+  }
+
+  objectId_t* leaves = node(0, 0);
+  for (objectId_t i=0; i<layerNodes[0]*B; i++) {
+    leaves[i] = (i<nKeys) ? bias(i*indexStep) : padding;
+  }
+
+  buildLayers();
+
+  if (verboseLevel>1) {
+    std::cout << "BTreeIndex<" << B << "> " << nKeys << " keys, height "
+	      << getHeight() << ", " << (treeBytes+chunkBytes)/1e6 << " MB"
+	      << std::endl;
+  }
+}
+
+
+// Internal key j of node k is the smallest key in child j+1, which is
+// the first key of the leftmost leaf below that child
+
+template <int B>
+void BTreeIndex<B>::buildLayers() {
+  objectId_t span = 1;			// Leaves below one node of layer h-1
+  for (size_t h=1; h<layerNodes.size(); h++) {
+    for (objectId_t k=0; k<layerNodes[h]; k++) {
+      objectId_t* keys = node(h, k);
+      for (int j=0; j<B; j++) {
+	objectId_t leaf = (k*(B+1) + j+1) * span;
+	keys[j] = (leaf < layerNodes[0]) ? node(0, leaf)[0] : padding;
+      }
+    }
+    span *= B+1;
+  }
+}
+
+
+// Number of keys in node less than or equal to biased key
+
+template <int B>
+unsigned BTreeIndex<B>::rank(const objectId_t* node, objectId_t bkey) {
+#ifdef __AVX2__
+  __m256i x = _mm256_set1_epi64x((long long)bkey);
+  unsigned greater = 0;
+  for (int i=0; i<B; i+=4) {
+    __m256i keys = _mm256_load_si256((const __m256i*)(node+i));
+    __m256i gt = _mm256_cmpgt_epi64(keys, x);
+    greater |= _mm256_movemask_pd(_mm256_castsi256_pd(gt)) << i;
+  }
+  return B - __builtin_popcount(greater);
+#else
+  unsigned count = 0;
+  for (int i=0; i<B; i++) count += ((long long)node[i] <= (long long)bkey);
+  return count;
+#endif
+}
+
+
+// Descend from root, choosing child by rank in each node
+
+template <int B>
+chunkId_t BTreeIndex<B>::value(objectId_t index) {
+  if (!tree) return 0xdeadbeef;		// Include sanity check
+
+  objectId_t bkey = bias(index);
+  if (bkey == padding) return 0xdeadbeef;	// Would rank past padding
+
+  objectId_t k = 0;
+  for (int h=layerNodes.size()-1; h>0; h--) {
+    k = k*(B+1) + rank(node(h,k), bkey);
+
+    if (prefetch) {			// Second line of child, then payload
+      if (B*sizeof(objectId_t) > 64) __builtin_prefetch(node(h-1,k)+8);
+      if (h == 1) __builtin_prefetch(chunks + k*B);
+    }
+  }
+
+  const objectId_t* leaf = node(0,k);
+  unsigned i = rank(leaf, bkey);
+  return (i>0 && leaf[i-1] == bkey) ? chunks[k*B+i-1] : 0xdeadbeef;
+}
+
+
+// Storage cost per entry, including padding and internal nodes
+
+template <int B>
+double BTreeIndex<B>::bytesPerEntry() const {
+  return (nKeys>0 ? (double)(treeBytes+chunkBytes)/nKeys : 0.);
+}
+
+
+// Append tree shape and storage cost to CSV report
+
+template <int B>
+void BTreeIndex<B>::reportHeadings(std::ostream& csv) const {
+  csv << ", Height, Bytes/entry, Pages";
+}
+
+template <int B>
+void BTreeIndex<B>::reportColumns(std::ostream& csv) const {
+  PagePolicy usedPolicy = std::min(treePolicy, chunkPolicy);	// Weakest
+
+  csv << ", " << getHeight() << ", " << bytesPerEntry()
+      << ", " << pagePolicyName(usedPolicy);
+}
+
+
+// Node sizes used by index-performance
+
+template class BTreeIndex<8>;
+template class BTreeIndex<16>;
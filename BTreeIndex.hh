@@ -0,0 +1,71 @@
+#ifndef BTREE_INDEX_HH
+#define BTREE_INDEX_HH 1
+// $Id$
+// BTreeIndex.hh -- Exercise performance of static (bulk-loaded, read-only)
+// B+ tree with cache-line nodes as lookup table.  Number of keys per node
+// is a template parameter, instantiated for 8 (one 64-byte cache line)
+// and 16 (two cache lines).
+//
+// 20261017  Michael Kelsey
+// 20261017  Select page policy; name CSV output by configuration
+
+#include "IndexTester.hh"
+#include "PageAlloc.hh"
+#include <string>
+#include <vector>
+
+
+template <int B>
+class BTreeIndex : public IndexTester {
+public:
+  BTreeIndex(int verbose=0);
+  virtual ~BTreeIndex() { cleanup(); }
+
+  void setPrefetch(bool pf=true);
+  void setPagePolicy(PagePolicy policy=HugeTHP);
+  void setHugePages(bool huge=true) { setPagePolicy(huge?HugeTHP:SmallPages); }
+
+  int getHeight() const { return layerStart.size(); }
+  double bytesPerEntry() const;
+
+protected:
+  virtual void create(objectId_t asize);
+  virtual chunkId_t value(objectId_t index);
+  virtual void cleanup();
+
+  virtual void reportHeadings(std::ostream& csv) const;
+  virtual void reportColumns(std::ostream& csv) const;
+
+  void buildLayers();
+  void updateName();
+
+  // Keys are stored with sign bit flipped, for signed SIMD comparisons
+  static objectId_t bias(objectId_t key) { return key ^ (1ULL<<63); }
+  // Fills unused key slots; objectId ~0 is reserved, never stored or found
+  static const objectId_t padding = ~0ULL ^ (1ULL<<63);	// Biased maximum
+
+  // Number of keys in node less than or equal to biased key
+  static unsigned rank(const objectId_t* node, objectId_t bkey);
+
+  objectId_t* node(int layer, objectId_t inode) const {
+    return tree + (layerStart[layer] + inode)*B;
+  }
+
+private:
+  bool prefetch;
+  PagePolicy pagePolicy;		// Requested
+  PagePolicy treePolicy;		// Used, after any fallback
+  PagePolicy chunkPolicy;
+  std::string typeName;			// Configured name for CSV output
+
+  objectId_t nKeys;
+  std::vector<objectId_t> layerStart;	// First node in layer, 0 = leaves
+  std::vector<objectId_t> layerNodes;	// Number of nodes in layer
+
+  objectId_t* tree;			// Layers stored root first
+  size_t treeBytes;
+  chunkId_t* chunks;			// Parallel to leaf keys
+  size_t chunkBytes;
+};
+
+#endif	/* BTREE_INDEX_HH */
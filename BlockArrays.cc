@@ -5,46 +5,284 @@
 // 20151024  Michael Kelsey
 // 20160217  Force sequential indices, overriding user setting
 // 20160224  Move destructor action to cleanup() function
+// 20261017  Cover partial final block; check index range
+// 20261017  Multi-level page table over 64-bit objectIds:  directories
+//	     keyed on high bits, leaf blocks allocated on first write;
+//	     sparse indices are supported
+// 20261017  Allocate blocks from OS with selectable page policy
+// 20261017  Optional bit-packed leaf blocks, sized from generated chunks
+// 20261017  Page-sized directories above the first level, so an isolated
+//	     high objectId costs a few 4 KB pages instead of 8 MB each
 
 #include "BlockArrays.hh"
+#include "PackedArray.hh"
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <string>
 
 
-// Create a set of subarrays to cover the whole index range
+// Fill table with zeroes (or generated chunks, if packed) at every
+// (sparsified) objectId; leaf blocks are only allocated where objectIds fall
 
 void BlockArrays::create(objectId_t asize) {
-  SetIndexSpacing(1);			// Ensure that indices are dense
-
-  if (blocks) cleanup();		// Avoid memory leaks
-  blockCount = 0;
+  if (root) cleanup();			// Avoid memory leaks
   
   if (asize==0) return;
-  
-  blockCount = asize / blockSize;
-  blocks = new chunkId_t* [blockCount]();
-  for (unsigned i=0; i<blockCount; i++) {
-    blocks[i] = new chunkId_t[blockSize]();		// Fill with zeroes
+
+  // Packed width leaves all ones free to mark absent entries; with huge
+  // pages, round up so every block is the same length under any policy
+  if (packed) {
+    chunkGen.reset();
+    packBits = PackedArray::bitsFor(chunkGen.maxChunk()+1ULL);
+    leafBytes = sizeof(uint64_t) * PackedArray::wordsFor(1ULL<<leafBits,
+							  packBits);
+    if (pagePolicy != SmallPages) {
+      size_t page = pageSize(Huge2M);
+      leafBytes = (leafBytes + page-1) / page * page;
+    }
+  } else {
+    leafBytes = sizeof(chunkId_t) << leafBits;
+  }
+
+  for (objectId_t i=0; i<asize; i++) {
+    setEntry(i*indexStep, packed ? chunkGen.next() : 0);
+  }
+
+  if (verboseLevel>1)
+    std::cout << " " << height << " levels, " << nDirs+nUpper
+	      << " directories, "
+	      << nLeaves << " leaf blocks" << std::endl;
+}
+
+
+// Bulk update from file of "objectId chunkId" lines
+
+void BlockArrays::update(const char* datafile) {
+  if (!datafile) return;
+
+  std::ifstream bulkfile(datafile);
+  if (!bulkfile) {
+    std::cerr << "BlockArrays::update " << datafile << " not found"
+	      << std::endl;
+    return;
+  }
+
+  objectId_t objID;
+  chunkId_t chunk;
+  while (bulkfile >> objID >> chunk) setEntry(objID, chunk);
+}
+
+
+// Walk down from root, replacing shared absent nodes with new ones
+
+void BlockArrays::setEntry(objectId_t index, chunkId_t chunk) {
+  while (!root || index > maxIndex) grow();
+
+  void** slot = &root;
+  for (int lvl=height; lvl>0; lvl--) {
+    if (*slot == absent[lvl]) *slot = newNode(lvl);
+    slot = (void**)*slot + ((index >> shiftFor(lvl)) & maskFor(lvl));
+  }
+
+  if (*slot == absent[0]) *slot = newNode(0);
+
+  if (!packed) {
+    ((chunkId_t*)*slot)[index & leafMask] = chunk;
+  } else if (chunk < PackedArray::maskFor(packBits)) {
+    PackedArray::set((uint64_t*)*slot, index & leafMask, packBits, chunk);
+  } else {
+    std::cerr << "BlockArrays chunk " << chunk << " does not fit in "
+	      << packBits << " bits" << std::endl;
   }
 }
 
 
-// Access requested array element with existence check
+// Access requested array element; absent blocks are filled with 0xdeadbeef
 
 chunkId_t BlockArrays::value(objectId_t index) {
-  if (blockCount == 0 || blocks == 0) return 0xdeadbeef;
-  return blocks[index/blockSize][index%blockSize];
+  if (!root || index > maxIndex) return 0xdeadbeef;
+
+  void* node = root;				// Height is at least one
+  for (int lvl=height; lvl>1; lvl--) {
+    node = ((void**)node)[(index >> shiftFor(lvl)) & upperMask];
+  }
+  node = ((void**)node)[(index >> leafBits) & dirMask];
+
+  if (!packed) return ((chunkId_t*)node)[index & leafMask];
+
+  uint64_t chunk = PackedArray::get((uint64_t*)node, index&leafMask, packBits);
+  return (chunk == PackedArray::maskFor(packBits)) ? 0xdeadbeef : chunk;
+}
+
+
+// Put new directory above current root, extending the range by its fan-out
+
+void BlockArrays::grow() {
+  makeAbsent(height+1);
+
+  void* oldRoot = root;
+  root = absent[height+1];
+  if (oldRoot) {
+    root = newNode(height+1);
+    ((void**)root)[0] = oldRoot;
+  }
+
+  height++;
+
+  int rangeBits = shiftFor(height+1);
+  maxIndex = (rangeBits < 64) ? (1ULL<<rangeBits)-1 : ~0ULL;
+}
+
+
+// Shared nodes for ranges with no objectIds; each level points to the
+// level below, with the leaf at the bottom
+
+void BlockArrays::makeAbsent(int level) {
+  while ((int)absent.size() <= level) {
+    if (absent.empty()) {
+      void* leaf = allocBlock(leafBytes);
+      if (packed) memset(leaf, 0xff, leafBytes);
+      else std::fill((chunkId_t*)leaf, (chunkId_t*)leaf+(1ULL<<leafBits),
+		     0xdeadbeef);
+      absent.push_back(leaf);
+    } else {
+      void** dir = (void**)allocDir(absent.size());
+      std::fill(dir, dir+maskFor(absent.size())+1, absent.back());
+      absent.push_back(dir);
+    }
+  }
+}
+
+void* BlockArrays::newNode(int level) {
+  makeAbsent(level);
+
+  if (level == 0) {
+    void* leaf = allocBlock(leafBytes);
+    memcpy(leaf, absent[0], leafBytes);
+    nLeaves++;
+    return leaf;
+  }
+
+  void** dir = (void**)allocDir(level);
+  std::fill(dir, dir+maskFor(level)+1, absent[level-1]);
+  if (level == 1) nDirs++;
+  else nUpper++;
+  return dir;
 }
 
 
-// Delete array block-by-block first, then the top level
+// Blocks are multiples of 2 MB (unless small pages are requested), so
+// the mapped length is the same for every policy; the weakest policy used
+// after fallback is reported
+
+void* BlockArrays::allocBlock(size_t nbytes) {
+  PagePolicy policy = pagePolicy;
+  void* block = allocatePages(nbytes, policy);
+  if (!block) {
+    std::cerr << "BlockArrays unable to allocate " << nbytes << " bytes"
+	      << std::endl;
+    ::abort();				// No sensible recovery
+  }
+
+  if (policy < usedPolicy) usedPolicy = policy;
+  return block;
+}
+
+// Upper directories are a single small page; huge pages would waste most
+// of each one
+
+void* BlockArrays::allocDir(int level) {
+  if (level == 1) return allocBlock(dirBytes);
+
+  PagePolicy policy = SmallPages;
+  void* dir = allocatePages(upperBytes, policy);
+  if (!dir) {
+    std::cerr << "BlockArrays unable to allocate " << upperBytes << " bytes"
+	      << std::endl;
+    ::abort();
+  }
+
+  return dir;
+}
+
+void BlockArrays::freeDir(void* dir, int level) {
+  freePages(dir, bytesFor(level), level==1 ? usedPolicy : SmallPages);
+}
+
+
+// Delete leaf blocks first, then the directories
+
+void BlockArrays::freeNode(void* node, int level) {
+  if (!node || node == absent[level]) return;
+
+  if (level == 0) {
+    freePages(node, leafBytes, usedPolicy);
+    return;
+  }
+
+  void** dir = (void**)node;
+  for (objectId_t i=0; i<=maskFor(level); i++) {
+    if (dir[i] != absent[level-1]) freeNode(dir[i], level-1);
+  }
+  freeDir(dir, level);
+}
 
 void BlockArrays::cleanup() {
-  if (blocks) {
-    for (unsigned i=0; i<blockCount; i++) {
-      delete[] blocks[i];
-      blocks[i] = 0;
+  if (root) freeNode(root, height);
+  root = 0;
+  height = 0;
+  maxIndex = 0;
+
+  if (!absent.empty()) {
+    freePages(absent[0], leafBytes, usedPolicy);
+    for (size_t i=1; i<absent.size(); i++) {
+      freeDir(absent[i], i);
     }
-    delete[] blocks;
-    blocks = 0;
+    absent.clear();
   }
-  blockCount = 0;
+
+  nLeaves = nDirs = nUpper = 0;
+  usedPolicy = pagePolicy;
+}
+
+
+// Explicit 1 GB pages would round each block up to 1 GB; use 2 MB pages
+
+void BlockArrays::setPagePolicy(PagePolicy policy) {
+  pagePolicy = usedPolicy = (policy == Huge1G) ? Huge2M : policy;
+  updateName();
+}
+
+void BlockArrays::setPacked(bool pack) {
+  packed = pack;
+  updateName();
+}
+
+void BlockArrays::updateName() {
+  typeName = "blocks";
+  if (packed) typeName += "-packed";
+  if (pagePolicy != SmallPages) {
+    typeName += "-";
+    typeName += pagePolicyName(pagePolicy);
+  }
+  SetName(typeName.c_str());
+}
+
+
+// Append structure and memory use
+
+void BlockArrays::reportHeadings(std::ostream& csv) const {
+  csv << ", Levels, Leaf blocks, Bytes/entry, Pages, Chunk bits";
+}
+
+void BlockArrays::reportColumns(std::ostream& csv) const {
+  double bytes = nLeaves*leafBytes + nDirs*dirBytes + nUpper*upperBytes;
+
+  csv << ", " << height << ", " << nLeaves << ", "
+      << (tableSize>0 ? bytes/tableSize : 0.)
+      << ", " << pagePolicyName(usedPolicy)
+      << ", " << (packed ? packBits : 8*sizeof(chunkId_t));
 }
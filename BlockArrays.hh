@@ -6,24 +6,91 @@
 //
 // 20151024  Michael Kelsey
 // 20160224  Move destructor action to cleanup() function
+// 20261017  Multi-level page table over 64-bit objectIds:  directories
+//	     keyed on high bits, leaf blocks allocated on first write
+// 20261017  Allocate blocks from OS with selectable page policy
+// 20261017  Optional bit-packed leaf blocks, sized from generated chunks
+// 20261017  Page-sized directories above the first level
 
 #include "IndexTester.hh"
+#include "ChunkGenerator.hh"
+#include "PageAlloc.hh"
+#include <string>
+#include <vector>
 
 class BlockArrays : public IndexTester {
 public:
-  BlockArrays(int verbose=0) : IndexTester("blocks",verbose), 
-			       blockSize(1000000), blockCount(0), blocks(0) {;}
+  BlockArrays(int verbose=0) : IndexTester("blocks",verbose), root(0),
+			       height(0), maxIndex(0ULL), nLeaves(0ULL),
+			       nDirs(0ULL), nUpper(0ULL), packed(false),
+			       packBits(0),
+			       leafBytes(sizeof(chunkId_t) << leafBits),
+			       pagePolicy(SmallPages),
+			       usedPolicy(SmallPages) {;}
   virtual ~BlockArrays() { cleanup(); }
 
+  void setEntry(objectId_t index, chunkId_t chunk);	// Allocates blocks
+
+  void setPagePolicy(PagePolicy policy=SmallPages);	// Changes CSV name
+  void setPacked(bool pack=true);			// Changes CSV name
+
 protected:
   virtual void create(objectId_t asize);
+  virtual void update(const char* datafile);
   virtual chunkId_t value(objectId_t index);
   virtual void cleanup();
 
+  virtual void reportHeadings(std::ostream& csv) const;
+  virtual void reportColumns(std::ostream& csv) const;
+
+  void grow();				// Add directory level above root
+  void* newNode(int level);		// Copy of absent node at level
+  void makeAbsent(int level);
+  void* allocBlock(size_t nbytes);
+  void* allocDir(int level);
+  void freeNode(void* node, int level);
+  void freeDir(void* dir, int level);
+  void updateName();
+
+  static const int leafBits = 20;	// 1M entries per leaf block
+  static const int dirBits = 20;	// 1M blocks per first-level directory
+  static const int upperBits = 9;	// 512 entries (4 KB) per upper one
+  static const objectId_t leafMask = (1ULL<<leafBits)-1;
+  static const objectId_t dirMask = (1ULL<<dirBits)-1;
+  static const objectId_t upperMask = (1ULL<<upperBits)-1;
+  static const size_t dirBytes = sizeof(void*) << dirBits;
+  static const size_t upperBytes = sizeof(void*) << upperBits;
+
+  // Index bits below directory level, and its fan-out
+  static int shiftFor(int level) {
+    return (level<=1) ? leafBits : leafBits+dirBits+upperBits*(level-2);
+  }
+  static objectId_t maskFor(int level) {
+    return (level<=1) ? dirMask : upperMask;
+  }
+  static size_t bytesFor(int level) {
+    return (level<=1) ? dirBytes : upperBytes;
+  }
+
 private:
-  const size_t blockSize;
-  unsigned blockCount;
-  chunkId_t** blocks;
+  void* root;				// Directory at level "height"
+  int height;				// Number of directory levels
+  objectId_t maxIndex;			// Largest index covered by root
+
+  std::vector<void*> absent;		// Shared, never written; leaf is [0]
+
+  objectId_t nLeaves;			// Allocated (not shared) blocks
+  objectId_t nDirs;			// First-level directories
+  objectId_t nUpper;			// Page-sized upper directories
+
+  bool packed;				// Leaf blocks are PackedArray words
+  unsigned packBits;			// All ones marks absent entry
+  ChunkGenerator chunkGen;		// Chunks for packed blocks
+  size_t leafBytes;
+
+  PagePolicy pagePolicy;		// Requested
+  PagePolicy usedPolicy;		// Weakest used, after any fallback
+  std::string typeName;
 };
 
 #endif	/* BLOCK_ARRAYS_HH */
@@ -0,0 +1,238 @@
+// $Id$
+// BlockFile.cc -- On-disk table of sorted (objectId, chunkId) pairs in
+// 4 KiB aligned blocks, with in-memory fence pointers (first key of each
+// block), so that each lookup is one search in memory and one pread().
+//
+// 20261017  Michael Kelsey
+// 20261017  Expose trailer layout and block search, for remote readers
+
+#define _FILE_OFFSET_BITS 64	/* Enables large-file support */
+
+#include "BlockFile.hh"
+#include "SearchKernels.hh"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <iostream>
+
+
+// Constructor
+
+BlockFile::BlockFile()
+  : fd(-1), directfd(-1), writing(false), nKeys(0ULL), maxKey(0ULL),
+    buffer(0), nReads(0L) {
+  void* buf = 0;
+  if (posix_memalign(&buf, blockBytes, sizeof(Block)) == 0) {
+    buffer = (Block*)buf;
+  }
+}
+
+BlockFile::~BlockFile() {
+  close();
+  free(buffer);
+}
+
+static_assert(sizeof(BlockFile::Block) == BlockFile::blockBytes,
+	      "BlockFile::Block must fill one disk block");
+
+
+// Close file descriptors, discard fence pointers
+
+void BlockFile::close() {
+  if (fd >= 0) ::close(fd);
+  if (directfd >= 0) ::close(directfd);
+  fd = directfd = -1;
+
+  writing = false;
+  fences.clear();
+  pending.clear();
+  nKeys = maxKey = 0;
+}
+
+void BlockFile::remove() {
+  close();
+  if (!fname.empty()) unlink(fname.c_str());
+  fname.clear();
+}
+
+// Open new file for writing blocks in sequence
+
+bool BlockFile::create(const std::string& path) {
+  close();
+
+  fname = path;
+  fd = ::open(fname.c_str(), O_WRONLY|O_CREAT|O_TRUNC, 0644);
+  if (fd < 0) {
+    perror(("BlockFile create " + fname).c_str());
+    return false;
+  }
+
+  writing = true;
+  pending.reserve(256);
+  nReads = 0;
+  return true;
+}
+
+bool BlockFile::append(objectId_t key, chunkId_t chunk) {
+  if (!writing) return false;
+
+  if (nKeys > 0 && key <= maxKey) {
+    std::cerr << "BlockFile " << fname << " key " << key
+	      << " out of order" << std::endl;
+    return false;
+  }
+
+  if (pending.empty() || pending.back().count == (uint32_t)blockKeys) {
+    if (pending.size() == pending.capacity() && !flushBlocks()) return false;
+
+    pending.push_back(Block());			// Zero-filled
+    fences.push_back(key);
+  }
+
+  Block& blk = pending.back();
+  blk.key[blk.count] = key;
+  blk.chunk[blk.count] = chunk;
+  blk.count++;
+
+  nKeys++;
+  maxKey = key;
+  return true;
+}
+
+bool BlockFile::flushBlocks() {
+  size_t nbytes = pending.size()*sizeof(Block);
+  const char* data = (const char*)&pending[0];
+  while (nbytes > 0) {
+    ssize_t nw = write(fd, data, nbytes);
+    if (nw < 0) {
+      if (errno == EINTR) continue;
+      perror(("BlockFile write " + fname).c_str());
+      return false;
+    }
+    data += nw;
+    nbytes -= nw;
+  }
+
+  pending.clear();
+  return true;
+}
+
+
+// Write final blocks, fence pointers and footer, then reopen for reading
+
+bool BlockFile::finish(bool direct) {
+  if (!writing) return false;
+
+  Footer foot = { fileMagic, fences.size(), nKeys, maxKey };
+
+  bool ok = pending.empty() || flushBlocks();
+  if (ok && !fences.empty()) {
+    ssize_t nbytes = fenceBytes();
+    ok = (write(fd, &fences[0], nbytes) == nbytes);
+  }
+  if (ok) ok = (write(fd, &foot, sizeof(foot)) == sizeof(foot));
+
+  if (!ok) perror(("BlockFile finish " + fname).c_str());
+
+  std::string path = fname;
+  close();
+  return ok && open(path, direct);
+}
+
+
+// Open existing file, loading fence pointers from trailer
+
+bool BlockFile::open(const std::string& path, bool direct) {
+  close();
+
+  fname = path;
+  fd = ::open(fname.c_str(), O_RDONLY);
+  if (fd < 0) {
+    perror(("BlockFile open " + fname).c_str());
+    return false;
+  }
+
+  struct stat info;
+  Footer foot;
+  if (fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(foot) ||
+      pread(fd, &foot, sizeof(foot), info.st_size-sizeof(foot))
+      != sizeof(foot) || foot.magic != fileMagic) {
+    std::cerr << "BlockFile " << fname << " is not a block file" << std::endl;
+    close();
+    return false;
+  }
+
+  fences.resize(foot.nBlocks);
+  ssize_t nbytes = fenceBytes();
+  if (nbytes > 0 &&
+      pread(fd, &fences[0], nbytes, foot.nBlocks*blockBytes) != nbytes) {
+    perror(("BlockFile fences " + fname).c_str());
+    close();
+    return false;
+  }
+
+  nKeys = foot.nKeys;
+  maxKey = foot.maxKey;
+  nReads = 0;
+
+#ifdef O_DIRECT
+  if (direct) {
+    directfd = ::open(fname.c_str(), O_RDONLY|O_DIRECT);
+    if (directfd < 0) perror(("BlockFile O_DIRECT " + fname).c_str());
+  }
+#endif
+
+  return true;
+}
+
+
+// Locate block which may contain key, using fence pointers
+
+int64_t BlockFile::findBlock(objectId_t key) const {
+  return fences.empty() ? -1 : locate(&fences[0], fences.size(), maxKey, key);
+}
+
+int64_t BlockFile::locate(const objectId_t* fences, uint64_t nBlocks,
+			  objectId_t maxKey, objectId_t key) {
+  if (nBlocks == 0 || key < fences[0] || key > maxKey) return -1;
+
+  objectId_t pos = branchlessLowerBound(fences, nBlocks, key);
+  if (pos < nBlocks && fences[pos] == key) return pos;
+  return pos-1;
+}
+
+chunkId_t BlockFile::find(const Block& blk, objectId_t key) {
+  uint32_t count = std::min(blk.count, (uint32_t)blockKeys);	// Corrupt?
+  objectId_t pos = branchlessLowerBound(blk.key, count, key);
+  return (pos < count && blk.key[pos] == key) ? blk.chunk[pos] : 0xdeadbeef;
+}
+
+chunkId_t BlockFile::lookup(objectId_t key) {
+  int64_t iblock = findBlock(key);
+  if (iblock < 0 || !buffer) return 0xdeadbeef;
+
+  int rfd = (directfd >= 0) ? directfd : fd;
+  nReads++;
+  if (pread(rfd, buffer, blockBytes, (off_t)iblock*blockBytes)
+      != (ssize_t)blockBytes) return 0xdeadbeef;
+
+  return find(*buffer, key);
+}
+
+
+// Read block through page cache, for sequential scans
+
+bool BlockFile::readBlock(uint64_t iblock, Block& blk) const {
+  if (fd < 0 || iblock >= fences.size()) return false;
+
+  return (pread(fd, &blk, blockBytes, (off_t)iblock*blockBytes)
+	  == (ssize_t)blockBytes);
+}
+
+uint64_t BlockFile::fileBytes() const {
+  return fences.size()*(blockBytes+sizeof(objectId_t)) + sizeof(Footer);
+}
@@ -0,0 +1,99 @@
+#ifndef BLOCK_FILE_HH
+#define BLOCK_FILE_HH 1
+// $Id$
+// BlockFile.hh -- On-disk table of sorted (objectId, chunkId) pairs in
+// 4 KiB aligned blocks, with in-memory fence pointers (first key of each
+// block), so that each lookup is one search in memory and one pread().
+//
+// 20261017  Michael Kelsey
+// 20261017  Expose trailer layout and block search, for remote readers
+// 20261017  Report whether O_DIRECT was available
+
+#include "IndexTester.hh"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+
+class BlockFile {
+public:
+  static const size_t blockBytes = 4096;
+  static const int blockKeys = 340;		// Fills block after header
+
+  struct Block {
+    uint32_t count;				// Entries in use
+    uint32_t spare;
+    objectId_t key[blockKeys];			// Sorted
+    chunkId_t chunk[blockKeys];
+    char pad[blockBytes - 8 - blockKeys*(sizeof(objectId_t)+sizeof(chunkId_t))];
+  };
+
+  BlockFile();
+  ~BlockFile();
+
+  // Write new file; keys must be appended in increasing order.  When
+  // finished, the file is reopened for reading.
+  bool create(const std::string& path);
+  bool append(objectId_t key, chunkId_t chunk);
+  bool finish(bool direct=false);
+
+  // Read existing file, with fence pointers from trailer; O_DIRECT may be
+  // used for lookups, to bypass the page cache
+  bool open(const std::string& path, bool direct=false);
+  void close();
+  void remove();				// Close and delete file
+
+  // One pread() per lookup, into internal buffer (not thread-safe)
+  chunkId_t lookup(objectId_t key);
+
+  // Sequential access, for merging; uses caller's buffer (thread-safe)
+  bool readBlock(uint64_t iblock, Block& blk) const;
+
+  // For readers which fetch the trailer and blocks themselves (XRootD):
+  // file is nBlocks blocks, then nBlocks fence pointers, then Footer
+  struct Footer {
+    uint64_t magic;
+    uint64_t nBlocks;
+    uint64_t nKeys;
+    uint64_t maxKey;
+  };
+
+  static const uint64_t fileMagic = 0x424c4b4649444e58ULL;
+
+  static int64_t locate(const objectId_t* fences, uint64_t nBlocks,
+			objectId_t maxKey, objectId_t key);	// -1 if none
+  static chunkId_t find(const Block& blk, objectId_t key);
+
+  const std::string& path() const { return fname; }
+  uint64_t blocks() const { return fences.size(); }
+  uint64_t keys() const { return nKeys; }
+  objectId_t firstKey() const { return fences.empty() ? 0 : fences.front(); }
+  objectId_t lastKey() const { return maxKey; }
+  size_t fenceBytes() const { return fences.size()*sizeof(objectId_t); }
+  uint64_t fileBytes() const;
+  long reads() const { return nReads; }
+  bool isDirect() const { return directfd >= 0; }	// False if refused
+
+protected:
+  bool flushBlocks();				// Write buffered blocks
+  int64_t findBlock(objectId_t key) const;	// -1 if outside keys
+
+private:
+  BlockFile(const BlockFile&);			// Copying is not supported
+  BlockFile& operator=(const BlockFile&);
+
+  std::string fname;
+  int fd;					// Buffered, for scans
+  int directfd;					// O_DIRECT, for lookups
+  bool writing;
+
+  std::vector<objectId_t> fences;		// First key of each block
+  uint64_t nKeys;
+  objectId_t maxKey;
+
+  std::vector<Block> pending;			// Blocks not yet written
+  Block* buffer;				// Aligned, for O_DIRECT
+  long nReads;
+};
+
+#endif	/* BLOCK_FILE_HH */
@@ -0,0 +1,49 @@
+// $Id$
+// ChunkGenerator.cc -- Produce realistic chunk numbers for a sequence of
+// objectIds:  contiguous runs of objects are assigned to the same chunk,
+// with occasional "stragglers" assigned to some other chunk.
+//
+// 20261017  Michael Kelsey
+
+#include "ChunkGenerator.hh"
+
+
+// Constructor
+
+ChunkGenerator::ChunkGenerator(objectId_t mean, double frac, chunkId_t count)
+  : meanRun(mean), straggle(frac), nChunks(count), runChunk(0),
+    runLeft(0ULL) {
+  reset();
+}
+
+
+// Restart sequence from the beginning
+
+void ChunkGenerator::reset(unsigned long seed) {
+  if (meanRun == 0) meanRun = 1;		// Sanity checks
+  if (nChunks < 2) nChunks = 2;
+
+  rng.seed(seed);
+  runChunk = 0;
+  runLeft = 0;
+}
+
+
+// Chunk for next object in sequence; new run starts when current is used
+
+chunkId_t ChunkGenerator::next() {
+  if (runLeft == 0) {
+    runChunk = randomChunk();
+    runLeft = meanRun/2 + rng() % (meanRun+1);
+    if (runLeft == 0) runLeft = 1;
+  }
+
+  runLeft--;
+
+  if (straggle > 0. && uniform() < straggle) {
+    chunkId_t other = randomChunk();
+    return (other != runChunk) ? other : (other+1) % nChunks;
+  }
+
+  return runChunk;
+}
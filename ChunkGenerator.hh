@@ -0,0 +1,45 @@
+#ifndef CHUNK_GENERATOR_HH
+#define CHUNK_GENERATOR_HH 1
+// $Id$
+// ChunkGenerator.hh -- Produce realistic chunk numbers for a sequence of
+// objectIds:  contiguous runs of objects are assigned to the same chunk,
+// with occasional "stragglers" assigned to some other chunk.
+//
+// 20261017  Michael Kelsey
+
+#include "IndexTester.hh"
+#include <random>
+
+
+class ChunkGenerator {
+public:
+  ChunkGenerator(objectId_t meanRun=10000, double straggle=1e-4,
+		 chunkId_t nChunks=100000);
+  ~ChunkGenerator() {;}
+
+  // Configuration takes effect at next reset()
+  void setMeanRun(objectId_t mean) { meanRun = mean; }
+  void setStragglerFraction(double frac) { straggle = frac; }
+  void setChunkCount(chunkId_t count) { nChunks = count; }
+
+  objectId_t getMeanRun() const { return meanRun; }
+  double getStragglerFraction() const { return straggle; }
+  chunkId_t maxChunk() const { return nChunks-1; }
+
+  void reset(unsigned long seed=20151023UL);	// Restart same sequence
+  chunkId_t next();				// Chunk for next object
+
+private:
+  chunkId_t randomChunk() { return rng() % nChunks; }
+  double uniform() { return (rng() >> 11) * (1./9007199254740992.); }
+
+  objectId_t meanRun;		// Run lengths are uniform in [mean/2,3mean/2]
+  double straggle;		// Fraction of objects outside their run
+  chunkId_t nChunks;
+
+  std::mt19937_64 rng;		// Private engine, independent of random()
+  chunkId_t runChunk;
+  objectId_t runLeft;		// Objects remaining in current run
+};
+
+#endif	/* CHUNK_GENERATOR_HH */
@@ -0,0 +1,73 @@
+// $Id$
+// DiskBlockIndex.cc -- Exercise performance of sorted block file (on SSD)
+// as lookup table:  one in-memory fence pointer search and one pread()
+// per lookup, independent of how sparse the objectIds are.
+//
+// 20261017  Michael Kelsey
+// 20261017  Drop "-direct" from name if O_DIRECT is refused
+
+#include "DiskBlockIndex.hh"
+#include <iostream>
+
+
+// Constructor
+
+DiskBlockIndex::DiskBlockIndex(int verbose)
+  : IndexTester("diskblock",verbose), fname("/tmp/index-blocks.dat"),
+    direct(false), nLookups(0L) {;}
+
+void DiskBlockIndex::setDirect(bool dir) {
+  direct = dir;
+  SetName(direct ? "diskblock-direct" : "diskblock");
+}
+
+
+// Close and delete file from filesystem
+
+void DiskBlockIndex::cleanup() {
+  blocks.remove();
+  nLookups = 0;
+}
+
+
+// Write sorted keys with clustered chunks, then reopen for lookups
+
+void DiskBlockIndex::create(objectId_t asize) {
+  cleanup();				// Discard previous file
+  if (asize == 0) return;
+
+  if (!blocks.create(fname)) return;
+
+  chunkGen.reset();
+  for (objectId_t i=0; i<asize; i++) {
+    blocks.append(i*indexStep, chunkGen.next());
+  }
+  blocks.finish(direct);
+  SetName(blocks.isDirect() ? "diskblock-direct" : "diskblock");
+
+  if (verboseLevel>1) {
+    std::cout << " " << blocks.blocks() << " blocks, " << blocks.fenceBytes()
+	      << " bytes of fence pointers" << std::endl;
+  }
+}
+
+
+// One read per lookup, unless fence pointers exclude objectId
+
+chunkId_t DiskBlockIndex::value(objectId_t index) {
+  nLookups++;
+  return blocks.lookup(index);
+}
+
+
+// Append file layout, and reads per lookup
+
+void DiskBlockIndex::reportHeadings(std::ostream& csv) const {
+  csv << ", Blocks, Fence (bytes), File (bytes), Reads/lookup";
+}
+
+void DiskBlockIndex::reportColumns(std::ostream& csv) const {
+  csv << ", " << blocks.blocks() << ", " << blocks.fenceBytes()
+      << ", " << blocks.fileBytes() << ", "
+      << (nLookups>0 ? (double)blocks.reads()/nLookups : 0.);
+}
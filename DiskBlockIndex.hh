@@ -0,0 +1,38 @@
+#ifndef DISK_BLOCK_INDEX_HH
+#define DISK_BLOCK_INDEX_HH 1
+// $Id$
+// DiskBlockIndex.hh -- Exercise performance of sorted block file (on SSD)
+// as lookup table:  one in-memory fence pointer search and one pread()
+// per lookup, independent of how sparse the objectIds are.
+//
+// 20261017  Michael Kelsey
+
+#include "IndexTester.hh"
+#include "BlockFile.hh"
+#include "ChunkGenerator.hh"
+
+
+class DiskBlockIndex : public IndexTester {
+public:
+  DiskBlockIndex(int verbose=0);
+  virtual ~DiskBlockIndex() { cleanup(); }
+
+  void setDirect(bool direct);			// O_DIRECT for lookups
+
+protected:
+  virtual void create(objectId_t asize);
+  virtual chunkId_t value(objectId_t index);
+  virtual void cleanup();
+
+  virtual void reportHeadings(std::ostream& csv) const;
+  virtual void reportColumns(std::ostream& csv) const;
+
+private:
+  const char* fname;
+  bool direct;
+  long nLookups;
+  BlockFile blocks;
+  ChunkGenerator chunkGen;
+};
+
+#endif	/* DISK_BLOCK_INDEX_HH */
@@ -0,0 +1,157 @@
+// $Id$
+// EliasFanoIndex.cc -- Exercise performance of Elias-Fano compressed key
+// set as lookup table.  The rank of a key in the set locates its chunk in
+// a bit-packed array.
+//
+// 20261017  Michael Kelsey
+
+#include "EliasFanoIndex.hh"
+#include <iostream>
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+
+// Constructor and destructor
+
+EliasFanoIndex::EliasFanoIndex(int verbose)
+  : IndexTester("eliasfano",verbose), nKeys(0ULL), maxKey(0ULL), lowBits(0),
+    upperSize(0ULL) {;}
+
+void EliasFanoIndex::cleanup() {
+  lower.clear();
+  std::vector<uint64_t>().swap(upper);	// Releases memory, unlike clear()
+  std::vector<uint64_t>().swap(zeroSamples);
+  chunks.clear();
+
+  nKeys = maxKey = upperSize = 0;
+  lowBits = 0;
+}
+
+
+// Encode full range of keys, with clustered chunk assignments
+
+void EliasFanoIndex::create(objectId_t asize) {
+  cleanup();				// Discard previous table
+  if (asize == 0) return;
+
+  nKeys = asize;
+  maxKey = (nKeys-1)*indexStep;
+
+  // Split of low and high bits minimizes total size
+  uint64_t universe = maxKey+1;
+  lowBits = (universe > nKeys) ? PackedArray::bitsFor(universe/nKeys)-1 : 0;
+
+  lower.resize(nKeys, lowBits);
+  upperSize = nKeys + (maxKey >> lowBits) + 1;
+  upper.assign(upperSize/64 + 1, 0ULL);
+
+  chunkGen.reset();
+  chunks.resize(nKeys, PackedArray::bitsFor(chunkGen.maxChunk()));
+
+  uint64_t lowMask = (1ULL << lowBits) - 1;
+  for (objectId_t i=0; i<nKeys; i++) {
+    objectId_t key = i*indexStep;
+    lower.set(i, key & lowMask);
+
+    uint64_t pos = (key >> lowBits) + i;	// One bit per key, in order
+    upper[pos>>6] |= 1ULL << (pos&63);
+
+    chunks.set(i, chunkGen.next());
+  }
+
+  buildSamples();
+
+  if (verboseLevel>1) {
+    std::cout << "EliasFanoIndex " << nKeys << " keys, " << lowBits
+	      << " low bits, " << keyBits() << " bits/key + "
+	      << payloadBits() << " bits/key payload" << std::endl;
+  }
+}
+
+
+// Record position of every 256th zero in upper bits
+
+void EliasFanoIndex::buildSamples() {
+  zeroSamples.clear();
+
+  uint64_t nZeros = 0;
+  for (uint64_t pos=0; pos<upperSize; pos++) {
+    if (upperBit(pos)) continue;
+    if ((nZeros & ((1ULL<<sampleShift)-1)) == 0) zeroSamples.push_back(pos);
+    nZeros++;
+  }
+}
+
+
+// Position of given zero, scanning forward from nearest sample
+
+uint64_t EliasFanoIndex::select0(uint64_t rank) const {
+  uint64_t pos = zeroSamples[rank >> sampleShift];
+  rank &= (1ULL<<sampleShift)-1;
+
+  uint64_t iword = pos >> 6;
+  uint64_t zeros = ~upper[iword] & (~0ULL << (pos&63));
+  for (;;) {
+    unsigned count = __builtin_popcountll(zeros);
+    if (rank < count) return iword*64 + selectInWord(zeros, rank);
+
+    rank -= count;
+    zeros = ~upper[++iword];
+  }
+}
+
+unsigned EliasFanoIndex::selectInWord(uint64_t word, unsigned rank) {
+#ifdef __BMI2__
+  return __builtin_ctzll(_pdep_u64(1ULL << rank, word));
+#else
+  for (unsigned i=0; i<rank; i++) word &= word-1;	// Clear lowest bits
+  return __builtin_ctzll(word);
+#endif
+}
+
+
+// Keys with same high bits are consecutive ones following zero "high"
+
+chunkId_t EliasFanoIndex::value(objectId_t index) {
+  if (upper.empty() || index > maxKey) return 0xdeadbeef;
+
+  uint64_t high = index >> lowBits;
+  uint64_t low = index & ((1ULL << lowBits) - 1);
+
+  uint64_t pos = (high == 0) ? 0 : select0(high-1)+1;
+  for (uint64_t i=pos-high; upperBit(pos); pos++, i++) {
+    uint64_t keyLow = lower.get(i);
+    if (keyLow == low) return chunks.get(i);
+    if (keyLow > low) break;			// Low bits also sorted
+  }
+
+  return 0xdeadbeef;
+}
+
+
+// Storage cost per key, for key set and for payload
+
+double EliasFanoIndex::keyBits() const {
+  if (nKeys == 0) return 0.;
+
+  size_t bytes = lower.bytes() + upper.size()*sizeof(uint64_t)
+    + zeroSamples.size()*sizeof(uint64_t);
+  return 8.*bytes / nKeys;
+}
+
+double EliasFanoIndex::payloadBits() const {
+  return (nKeys>0 ? 8.*chunks.bytes()/nKeys : 0.);
+}
+
+
+// Append bits-per-key for keys and payload to CSV report
+
+void EliasFanoIndex::reportHeadings(std::ostream& csv) const {
+  csv << ", Key bits/key, Payload bits/key, Total bits/key";
+}
+
+void EliasFanoIndex::reportColumns(std::ostream& csv) const {
+  csv << ", " << keyBits() << ", " << payloadBits()
+      << ", " << keyBits()+payloadBits();
+}
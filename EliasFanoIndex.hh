@@ -0,0 +1,58 @@
+#ifndef ELIAS_FANO_INDEX_HH
+#define ELIAS_FANO_INDEX_HH 1
+// $Id$
+// EliasFanoIndex.hh -- Exercise performance of Elias-Fano compressed key
+// set as lookup table.  The rank of a key in the set locates its chunk in
+// a bit-packed array.
+//
+// 20261017  Michael Kelsey
+
+#include "IndexTester.hh"
+#include "ChunkGenerator.hh"
+#include "PackedArray.hh"
+#include <stdint.h>
+#include <vector>
+
+
+class EliasFanoIndex : public IndexTester {
+public:
+  EliasFanoIndex(int verbose=0);
+  virtual ~EliasFanoIndex() { cleanup(); }
+
+  double keyBits() const;		// Bits per key for key set
+  double payloadBits() const;		// Bits per key for chunk numbers
+
+protected:
+  virtual void create(objectId_t asize);
+  virtual chunkId_t value(objectId_t index);
+  virtual void cleanup();
+
+  virtual void reportHeadings(std::ostream& csv) const;
+  virtual void reportColumns(std::ostream& csv) const;
+
+  void buildSamples();
+  uint64_t select0(uint64_t rank) const;	// Position of rank'th zero
+
+  static unsigned selectInWord(uint64_t word, unsigned rank);
+
+  bool upperBit(uint64_t pos) const {
+    return (upper[pos>>6] >> (pos&63)) & 1;
+  }
+
+  static const unsigned sampleShift = 8;	// Zero sampled every 256
+
+private:
+  ChunkGenerator chunkGen;
+  objectId_t nKeys;
+  objectId_t maxKey;
+
+  unsigned lowBits;			// Low bits of key stored directly
+  PackedArray lower;
+  std::vector<uint64_t> upper;		// High bits as unary-coded gaps
+  uint64_t upperSize;			// Number of valid bits in upper
+  std::vector<uint64_t> zeroSamples;	// Skip pointers for select0()
+
+  PackedArray chunks;			// Indexed by rank of key
+};
+
+#endif	/* ELIAS_FANO_INDEX_HH */
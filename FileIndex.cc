@@ -4,14 +4,33 @@
 // 20151023  Michael Kelsey
 // 20160217  Support sparse (but evenly spaced) index values
 // 20160224  Move destructor action to cleanup() function
+// 20261017  Add memory-mapped access mode, with madvise() and preloading;
+//	     remove static buffer from value()
+// 20261017  Reject objectIds between sparsified values
+// 20261017  Add batched asynchronous access mode with io_uring, reporting
+//	     IOPS and batch latency
 
 #define _FILE_OFFSET_BITS 64	/* Enables large-file support */
 #define _LARGEFILE64_SOURCE
 
 #include "FileIndex.hh"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include <unistd.h>
+#include <sys/mman.h>
 #include <sys/types.h>
+#include <sys/uio.h>
+#include <iostream>
+#include <sstream>
+#include <string>
+#ifdef HAS_URING
+#include <liburing.h>
+#endif
 
 // NOTE:  MacOSX does not have "off64_t" type!  Why not?
 #if __APPLE__ && __MACH__
@@ -19,16 +38,117 @@ typedef off_t off64_t;
 #endif
 
 
+// Constructor
+
+FileIndex::FileIndex(int verbose)
+  : IndexTester("file",verbose), fname("/tmp/index-file.dat"), afile(0),
+    access(Stdio), advice(Normal), populate(false), lock(false),
+    mapfd(-1), mapLength(0), mapped(0), nEntries(0ULL), queueDepth(256),
+    direct(false), fixed(false), ringfd(-1), ring(0), ioBuffer(0),
+    nReads(0L), readTime(0.), nBatches(0L), batchTime(0.), maxBatchTime(0.),
+    modeName("file") {;}
+
+// Block size for O_DIRECT reads, and for each slot of I/O buffer
+
+static const size_t ioBlock = 4096;
+
+// Monotonic clock for batch latency
+
+static double clockNow() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+
 // Close and delete file from filesystem
 
 void FileIndex::cleanup() {
   if (afile) fclose(afile);
   afile = 0;
 
+  unmapFile();
+  closeRing();
   unlink(fname);
 }
 
 
+// Configuration for mapped access; CSV name is changed to match
+
+void FileIndex::setAccess(Access mode) {
+#ifndef HAS_URING
+  if (mode == Uring) {
+    std::cerr << "FileIndex: io_uring not available, using stdio" << std::endl;
+    mode = Stdio;
+  }
+#endif
+
+  access = mode;
+  updateName();
+}
+
+void FileIndex::setAdvice(Advice hint) {
+  advice = hint;
+  updateName();
+}
+
+void FileIndex::setPreload(bool pop, bool lck) {
+  populate = pop;
+  lock = lck;
+  updateName();
+}
+
+void FileIndex::setDirect(bool dir, bool fix) {
+  direct = dir;
+  fixed = fix;
+  updateName();
+}
+
+void FileIndex::updateName() {
+  modeName = "file";
+  if (access == Uring) {
+    modeName += "-uring";
+    if (direct) modeName += "-direct";
+    if (fixed)  modeName += "-fixed";
+  }
+  if (access == Mmap) {
+    modeName += "-mmap";
+    if (advice == Random)   modeName += "-random";
+    if (advice == WillNeed) modeName += "-willneed";
+    if (advice == HugePage) modeName += "-huge";
+    if (populate) modeName += "-populate";
+    if (lock)     modeName += "-lock";
+  }
+
+  SetName(modeName.c_str());
+}
+
+
+// Parse options from type string; any mapping option implies mmap
+
+void FileIndex::configure(const std::string& type) {
+  std::istringstream opts(type);
+  std::string opt;
+  getline(opts, opt, '-');		// Discard type name itself
+
+  Access mode = Stdio;
+  while (getline(opts, opt, '-')) {
+    if (opt == "mmap")     { mode = Mmap; }
+    else if (opt == "random")   { mode = Mmap; advice = Random; }
+    else if (opt == "willneed") { mode = Mmap; advice = WillNeed; }
+    else if (opt == "huge")     { mode = Mmap; advice = HugePage; }
+    else if (opt == "populate") { mode = Mmap; populate = true; }
+    else if (opt == "lock")     { mode = Mmap; lock = true; }
+    else if (opt == "uring")    { mode = Uring; }
+    else if (opt == "direct")   { mode = Uring; direct = true; }
+    else if (opt == "fixed")    { mode = Uring; fixed = true; }
+    else std::cerr << "FileIndex: unknown option " << opt << std::endl;
+  }
+
+  setAccess(mode);
+}
+
+
 // Create gigantic flat file full of index entries, then re-open for reading
 
 void FileIndex::create(objectId_t asize) {
@@ -40,19 +160,342 @@ void FileIndex::create(objectId_t asize) {
   }
 
   fclose(outf);		// Close and reopen for future access
-  afile = fopen(fname, "r");
+  nEntries = asize;
+
+  nReads = nBatches = 0;
+  readTime = batchTime = maxBatchTime = 0.;
+
+  if (access == Mmap) mapFile();
+  else if (access == Uring) openRing();
+  else afile = fopen(fname, "r");
+}
+
+
+// Map entire file read-only, apply access hint and optional preloading
+
+bool FileIndex::mapFile() {
+  unmapFile();
+  if (nEntries == 0) return false;
+
+  mapUsage.zero();
+  mapUsage.start();
+
+  mapfd = open(fname, O_RDONLY);
+  if (mapfd < 0) {
+    perror("FileIndex open");
+    mapUsage.end();
+    return false;
+  }
+
+  int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+  if (populate) flags |= MAP_POPULATE;
+#endif
+
+  mapLength = nEntries*sizeof(chunkId_t);
+  void* addr = mmap(0, mapLength, PROT_READ, flags, mapfd, 0);
+  if (addr == MAP_FAILED) {
+    perror("FileIndex mmap");
+    close(mapfd);
+    mapfd = -1;
+    mapLength = 0;
+    mapUsage.end();
+    return false;
+  }
+
+  mapped = (const chunkId_t*)addr;
+
+  int hint = MADV_NORMAL;
+  if (advice == Random)   hint = MADV_RANDOM;
+  if (advice == WillNeed) hint = MADV_WILLNEED;
+#ifdef MADV_HUGEPAGE
+  if (advice == HugePage) hint = MADV_HUGEPAGE;	// Needs filesystem support
+#endif
+  if (hint != MADV_NORMAL && madvise(addr, mapLength, hint) != 0)
+    perror("FileIndex madvise");
+
+#ifndef MAP_POPULATE
+  if (populate) {			// Touch every page to read it in
+    volatile chunkId_t sum = 0;
+    size_t pageEntries = sysconf(_SC_PAGESIZE)/sizeof(chunkId_t);
+    for (objectId_t i=0; i<nEntries; i+=pageEntries) sum += mapped[i];
+  }
+#endif
+
+  if (lock && mlock(addr, mapLength) != 0) perror("FileIndex mlock");
+
+  mapUsage.end();
+
+  if (verboseLevel>1) {
+    std::cout << "FileIndex mapped " << mapLength << " bytes as " << modeName
+	      << ": " << mapUsage << std::endl;
+  }
+
+  return true;
+}
+
+void FileIndex::unmapFile() {
+  if (mapped) {
+    if (lock) munlock((void*)mapped, mapLength);
+    munmap((void*)mapped, mapLength);
+  }
+  mapped = 0;
+  mapLength = 0;
+
+  if (mapfd >= 0) close(mapfd);
+  mapfd = -1;
 }
   
 
-// Access requested array element with existence check
+// Access requested array element with existence check; time is kept
+// here for IOPS, since a wrapper may call this without the base timer
 
 chunkId_t FileIndex::value(objectId_t index) {
+  if (mapped) return lookup(index);		// Not a file read
+
+  double start = clockNow();
+  chunkId_t val = lookup(index);
+  readTime += clockNow() - start;
+
+  return val;
+}
+
+chunkId_t FileIndex::lookup(objectId_t index) {
   // De-sparsify input value by step-size
-  off64_t offset = (off64_t)(sizeof(chunkId_t)*index/indexStep);
+  objectId_t entry = index/indexStep;
+  if (entry >= nEntries || index%indexStep != 0) return 0xdeadbeef;
 
-  if (0 != fseeko(afile, offset, SEEK_SET)) return 0xdeadbeef;
-  
-  static chunkId_t val;	   		// Avoid allocation overhead
-  fread(&val, sizeof(chunkId_t), 1, afile);
+  if (mapped) return mapped[entry];
+
+  if (ring) {
+    chunkId_t val;
+    ringValues(&index, &val, 1);
+    return val;
+  }
+
+  nReads++;
+  off64_t offset = (off64_t)(sizeof(chunkId_t)*entry);
+  if (!afile || 0 != fseeko(afile, offset, SEEK_SET)) return 0xdeadbeef;
+
+  chunkId_t val;
+  if (fread(&val, sizeof(chunkId_t), 1, afile) != 1) return 0xdeadbeef;
   return val;
 }
+
+
+// Batch of lookups, submitted together for io_uring access
+
+void FileIndex::values(const objectId_t* index, chunkId_t* chunk, size_t n) {
+  double start = clockNow();
+
+  if (ring) ringValues(index, chunk, n);
+  else {
+    for (size_t i=0; i<n; i++) chunk[i] = lookup(index[i]);
+  }
+
+  double elapsed = clockNow() - start;
+  nBatches++;
+  batchTime += elapsed;
+  readTime += elapsed;
+  if (elapsed > maxBatchTime) maxBatchTime = elapsed;
+}
+
+
+// Open file for io_uring, with buffer slot for each read in flight
+
+bool FileIndex::openRing() {
+#ifdef HAS_URING
+  closeRing();
+  if (nEntries == 0 || queueDepth == 0) return false;
+
+  ringfd = open(fname, O_RDONLY | (direct ? O_DIRECT : 0));
+  if (ringfd < 0 && direct) {		// Some filesystems (tmpfs) refuse
+    perror("FileIndex open O_DIRECT");
+    ringfd = open(fname, O_RDONLY);
+    direct = false;			// Report buffered reads as such
+    updateName();
+  }
+  if (ringfd < 0) {
+    perror("FileIndex open");
+    return false;
+  }
+
+  ring = new io_uring;
+  int err = io_uring_queue_init(queueDepth, ring, 0);
+  if (err < 0) {
+    std::cerr << "FileIndex io_uring_queue_init: " << strerror(-err)
+	      << std::endl;
+    delete ring;
+    ring = 0;
+    closeRing();
+    return false;
+  }
+
+  void* buf = 0;
+  if (posix_memalign(&buf, ioBlock, queueDepth*ioBlock) != 0) {
+    closeRing();
+    return false;
+  }
+  ioBuffer = (char*)buf;
+
+  if (fixed) {
+    iovec iov = { ioBuffer, queueDepth*ioBlock };
+    err = io_uring_register_buffers(ring, &iov, 1);
+    if (err < 0) {
+      std::cerr << "FileIndex io_uring_register_buffers: " << strerror(-err)
+		<< std::endl;
+      fixed = false;
+      updateName();
+    }
+  }
+
+  slotQuery.assign(queueDepth, 0);
+  slotOffset.assign(queueDepth, 0);
+  freeSlots.clear();
+  for (unsigned i=queueDepth; i>0; i--) freeSlots.push_back(i-1);
+
+  if (verboseLevel>1) {
+    std::cout << "FileIndex io_uring queue depth " << queueDepth
+	      << (direct ? ", O_DIRECT" : "") << (fixed ? ", fixed buffers" : "")
+	      << std::endl;
+  }
+
+  return true;
+#else
+  return false;
+#endif
+}
+
+void FileIndex::closeRing() {
+#ifdef HAS_URING
+  if (ring) io_uring_queue_exit(ring);	// Also unregisters buffers
+  delete ring;
+#endif
+  ring = 0;
+
+  free(ioBuffer);
+  ioBuffer = 0;
+
+  if (ringfd >= 0) close(ringfd);
+  ringfd = -1;
+}
+
+
+// Keep queue full with reads for the batch, harvesting completions in
+// whatever order they arrive
+
+void FileIndex::ringValues(const objectId_t* index, chunkId_t* chunk,
+			   size_t n) {
+#ifdef HAS_URING
+  size_t next = 0, done = 0;
+  unsigned inFlight = 0;
+
+  while (done < n) {
+    unsigned queued = 0;
+    while (next < n && !freeSlots.empty()) {
+      objectId_t entry = index[next]/indexStep;
+      if (entry >= nEntries || index[next]%indexStep != 0) {
+	chunk[next++] = 0xdeadbeef;
+	done++;
+	continue;
+      }
+
+      unsigned slot = freeSlots.back();
+      freeSlots.pop_back();
+
+      // O_DIRECT requires aligned block; otherwise read just the entry
+      off64_t offset = (off64_t)(sizeof(chunkId_t)*entry);
+      off64_t readAt = direct ? (offset & ~(off64_t)(ioBlock-1)) : offset;
+      unsigned length = direct ? ioBlock : sizeof(chunkId_t);
+      char* buf = ioBuffer + slot*ioBlock;
+
+      slotQuery[slot] = next;
+      slotOffset[slot] = offset - readAt;
+
+      io_uring_sqe* sqe = io_uring_get_sqe(ring);
+      if (fixed) io_uring_prep_read_fixed(sqe, ringfd, buf, length, readAt, 0);
+      else io_uring_prep_read(sqe, ringfd, buf, length, readAt);
+      io_uring_sqe_set_data(sqe, (void*)(uintptr_t)slot);
+
+      next++;
+      queued++;
+    }
+
+    if (queued) {
+      io_uring_submit(ring);
+      inFlight += queued;
+      nReads += queued;
+    }
+
+    if (inFlight == 0) continue;		// Rest of batch was invalid
+
+    // Wait for one completion, then take any others already done
+    io_uring_cqe* cqe = 0;
+    int err = io_uring_wait_cqe(ring, &cqe);
+    if (err == -EINTR || err == -EAGAIN) continue;
+    if (err < 0) {
+      std::cerr << "FileIndex io_uring_wait_cqe: " << strerror(-err)
+		<< std::endl;
+      resetRing(chunk, next, n);
+      return;
+    }
+
+    while (cqe) {
+      unsigned slot = (unsigned)(uintptr_t)io_uring_cqe_get_data(cqe);
+      size_t pos = slotQuery[slot];
+
+      if (cqe->res < (int)(slotOffset[slot]+sizeof(chunkId_t))) {
+	chunk[pos] = 0xdeadbeef;
+      } else {
+	memcpy(&chunk[pos], ioBuffer+slot*ioBlock+slotOffset[slot],
+	       sizeof(chunkId_t));
+      }
+
+      io_uring_cqe_seen(ring, cqe);
+      freeSlots.push_back(slot);
+      inFlight--;
+      done++;
+
+      cqe = 0;
+      if (io_uring_peek_cqe(ring, &cqe) < 0) cqe = 0;
+    }
+  }
+#else
+  for (size_t i=0; i<n; i++) chunk[i] = 0xdeadbeef;
+#endif
+}
+
+// Abandon reads still in flight, and the rest of the batch, then start
+// over with a new ring, so that stale completions cannot reach the next
+// batch.  Buffer is not freed, since the kernel may still write into it.
+
+void FileIndex::resetRing(chunkId_t* chunk, size_t next, size_t n) {
+  std::vector<bool> idle(queueDepth, false);
+  for (size_t i=0; i<freeSlots.size(); i++) idle[freeSlots[i]] = true;
+
+  for (unsigned slot=0; slot<queueDepth; slot++) {
+    if (!idle[slot]) chunk[slotQuery[slot]] = 0xdeadbeef;
+  }
+  for (size_t i=next; i<n; i++) chunk[i] = 0xdeadbeef;
+
+  ioBuffer = 0;				// Leaked deliberately
+  if (!openRing()) afile = fopen(fname, "r");	// Restores freeSlots
+}
+
+
+// Append mapping cost and page faults (minor faults are cache hits), and
+// read rate and batch latency
+
+void FileIndex::reportHeadings(std::ostream& csv) const {
+  csv << ", Map Clock (s), Map page fault, Map minor fault, Minor fault"
+      << ", Batch size, IOPS, Batch latency (us), Max batch (us)";
+}
+
+void FileIndex::reportColumns(std::ostream& csv) const {
+  csv << ", " << mapUsage.elapsed() << ", " << mapUsage.pageFaults()
+      << ", " << mapUsage.minorFaults() << ", " << GetUsage().minorFaults();
+
+  csv << ", " << GetBatchSize() << ", " << (readTime>0. ? nReads/readTime : 0.)
+      << ", " << (nBatches>0 ? 1e6*batchTime/nBatches : 0.)
+      << ", " << 1e6*maxBatchTime;
+}
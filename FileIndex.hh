@@ -5,23 +5,90 @@
 //
 // 20151023  Michael Kelsey
 // 20160224  Move destructor action to cleanup() function
+// 20261017  Add memory-mapped access mode, with madvise() and preloading
+// 20261017  Add batched asynchronous access mode with io_uring
 
 #include "IndexTester.hh"
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+struct io_uring;		// From liburing.h, used only with HAS_URING
 
 class FileIndex : public IndexTester {
 public:
-  FileIndex(int verbose=0) : IndexTester("file",verbose),
-			     fname("/tmp/index-file.dat"), afile(0) {;}
+  enum Access { Stdio, Mmap, Uring };
+  enum Advice { Normal, Random, WillNeed, HugePage };	// For madvise()
+
+  FileIndex(int verbose=0);
   virtual ~FileIndex() { cleanup(); }
 
+  // Configuration for mapped access; CSV name is changed to match
+  void setAccess(Access mode);
+  void setAdvice(Advice hint);
+  void setPreload(bool populate, bool lock=false);
+
+  // Configuration for io_uring access (requires liburing)
+  void setQueueDepth(unsigned depth=256) { queueDepth = depth; }
+  void setDirect(bool direct, bool fixed=false);	// O_DIRECT, fixed buffers
+
+  // Parse options from type string, e.g., "file-mmap-random-populate",
+  // or "file-uring-direct-fixed"
+  void configure(const std::string& type);
+
 protected:
   virtual void create(objectId_t asize);
   virtual chunkId_t value(objectId_t index);
+  virtual void values(const objectId_t* index, chunkId_t* chunk, size_t n);
   virtual void cleanup();
 
+  chunkId_t lookup(objectId_t index);		// Untimed single access
+
+  virtual void reportHeadings(std::ostream& csv) const;
+  virtual void reportColumns(std::ostream& csv) const;
+
+  bool mapFile();
+  void unmapFile();
+
+  bool openRing();
+  void closeRing();
+  void ringValues(const objectId_t* index, chunkId_t* chunk, size_t n);
+  void resetRing(chunkId_t* chunk, size_t next, size_t n);	// On failure
+  void updateName();
+
 private:
   const char* fname;
   FILE* afile;
+
+  Access access;
+  Advice advice;
+  bool populate;		// Use MAP_POPULATE to read in whole file
+  bool lock;			// Use mlock() to keep file in memory
+
+  int mapfd;
+  size_t mapLength;
+  const chunkId_t* mapped;
+  objectId_t nEntries;
+
+  unsigned queueDepth;		// Maximum reads in flight
+  bool direct;			// Use O_DIRECT, reading aligned blocks
+  bool fixed;			// Register buffers with kernel
+
+  int ringfd;
+  io_uring* ring;
+  char* ioBuffer;		// One aligned block per slot in queue
+  std::vector<size_t> slotQuery;	// Position in batch for each slot
+  std::vector<unsigned> slotOffset;	// Entry offset within block
+  std::vector<unsigned> freeSlots;
+
+  long nReads;			// File reads, for IOPS
+  double readTime;		// Time spent in file reads (s)
+  long nBatches;
+  double batchTime;		// Total and worst time for batches (s)
+  double maxBatchTime;
+
+  std::string modeName;		// Configured name for CSV output
+  UsageTimer mapUsage;		// Mapping and preloading, with page faults
 };
 
 #endif	/* FILE_INDEX_HH */
@@ -0,0 +1,207 @@
+// $Id$
+// FilteredIndex.cc -- Approximate-membership filter (Bloom or xor) in
+// front of another lookup table, so that queries for absent objectIds
+// are rejected without reaching the (possibly remote) table.
+//
+// 20261017  Michael Kelsey
+// 20261017  Pass batches of filtered queries to table
+// 20261017  Generate table keys for filter build, rather than copying
+// 20261017  Skip updated objectIds already in table, so keys are unique
+
+#include "FilteredIndex.hh"
+#include "KeyFilters.hh"
+#include <stdlib.h>
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <iostream>
+#include <string>
+#include <vector>
+
+
+// Constructor and destructor
+
+FilteredIndex::FilteredIndex(IndexTester* table, Filter type, int verbose)
+  : IndexTester("filtered",verbose), inner(table), filterType(type),
+    fpRate(0.01), filter(0), nRejected(0L), nPassed(0L), nFalse(0L) {
+  fullName = (filterType==Xor) ? "xor+" : "bloom+";
+  if (inner) fullName += inner->GetName();
+  SetName(fullName.c_str());
+}
+
+FilteredIndex::~FilteredIndex() {
+  cleanup();
+  delete inner;
+}
+
+void FilteredIndex::cleanup() {
+  if (inner) cleanupOf(inner);
+
+  delete filter;
+  filter = 0;
+  addedKeys.clear();
+}
+
+
+// Parse filter type from name, as "bloom" or "xor"
+
+bool FilteredIndex::knownFilter(const std::string& name) {
+  return (name == "bloom" || name == "xor");
+}
+
+FilteredIndex::Filter FilteredIndex::filterFromName(const std::string& name) {
+  return (name == "xor") ? Xor : Bloom;
+}
+
+
+// Build wrapped table, then filter over same set of keys
+
+void FilteredIndex::create(objectId_t asize) {
+  cleanup();				// Discard previous table
+  nRejected = nPassed = nFalse = 0L;
+  if (!inner) return;
+
+  inner->SetVerboseLevel(verboseLevel);
+  inner->SetIndexSpacing(indexStep);
+  inner->SetBatchSize(GetBatchSize());
+  inner->CreateTable(asize);
+  SetIndexSpacing(inner->GetIndexSpacing());	// Table may force density
+
+  buildFilter();
+}
+
+// Table's keys are generated, not copied; only bulk updates are stored
+
+void FilteredIndex::buildFilter() {
+  objectId_t nTable = tableSize, nKeys = tableSize + addedKeys.size();
+  unsigned step = indexStep;
+  const std::vector<objectId_t>& added = addedKeys;
+  KeyFilter::KeySource key = [nTable, step, &added](uint64_t k) {
+    return (k < nTable) ? k*step : added[k-nTable];
+  };
+
+  delete filter;
+  if (filterType == Xor) filter = new XorFilter(fpRate);
+  else filter = new BloomFilter(fpRate);
+
+  filterUsage.zero();
+  filterUsage.start();
+  filter->build(nKeys, key);
+  filterUsage.end();
+
+  if (verboseLevel>1)
+    std::cout << " built " << filter->name() << " filter for " << nKeys
+	      << " keys, " << filter->bytes() << " bytes" << std::endl;
+}
+
+
+// Pass bulk update to table, and add objectIds to filter; Bloom filter
+// takes new keys directly, xor filter must be rebuilt
+
+void FilteredIndex::update(const char* datafile) {
+  if (!inner || !datafile) return;
+
+  inner->UpdateTable(datafile);
+
+  // Updates may reassign existing objectIds; xor filter needs unique keys
+  std::vector<objectId_t> newKeys;
+  std::string line;
+  std::ifstream bulkfile(datafile);
+  while (std::getline(bulkfile, line)) {
+    if (line.empty()) continue;
+    objectId_t key = strtoull(line.c_str(), 0, 0);
+    if (!inTable(key)) newKeys.push_back(key);
+  }
+
+  std::sort(newKeys.begin(), newKeys.end());
+  newKeys.erase(std::unique(newKeys.begin(), newKeys.end()), newKeys.end());
+
+  std::vector<objectId_t> merged;
+  merged.reserve(addedKeys.size() + newKeys.size());
+  std::set_union(addedKeys.begin(), addedKeys.end(),
+		 newKeys.begin(), newKeys.end(), std::back_inserter(merged));
+  newKeys.clear();
+  std::set_difference(merged.begin(), merged.end(),
+		      addedKeys.begin(), addedKeys.end(),
+		      std::back_inserter(newKeys));
+  addedKeys.swap(merged);
+
+  BloomFilter* bloom = dynamic_cast<BloomFilter*>(filter);
+  if (bloom) {
+    for (size_t i=0; i<newKeys.size(); i++) bloom->insert(newKeys[i]);
+  } else {
+    buildFilter();
+  }
+}
+
+
+// Query table only if filter reports key may be present
+
+chunkId_t FilteredIndex::value(objectId_t index) {
+  if (!inner || !filter) return 0xdeadbeef;
+
+  if (!filter->contains(index)) {
+    nRejected++;
+    return 0xdeadbeef;
+  }
+
+  nPassed++;
+  chunkId_t chunk = valueOf(inner, index);
+  if (chunk == 0xdeadbeef) nFalse++;
+
+  return chunk;
+}
+
+
+// Filter batch, and pass remaining queries to table as smaller batch
+
+void FilteredIndex::values(const objectId_t* index, chunkId_t* chunk,
+			   size_t n) {
+  if (!inner || !filter) {
+    for (size_t i=0; i<n; i++) chunk[i] = 0xdeadbeef;
+    return;
+  }
+
+  passPos.clear();
+  passIndex.clear();
+  for (size_t i=0; i<n; i++) {
+    if (filter->contains(index[i])) {
+      passPos.push_back(i);
+      passIndex.push_back(index[i]);
+    } else {
+      chunk[i] = 0xdeadbeef;
+    }
+  }
+
+  nRejected += n - passPos.size();
+  nPassed += passPos.size();
+  if (passPos.empty()) return;
+
+  passChunk.resize(passPos.size());
+  valuesOf(inner, &passIndex[0], &passChunk[0], passIndex.size());
+
+  for (size_t i=0; i<passPos.size(); i++) {
+    chunk[passPos[i]] = passChunk[i];
+    if (passChunk[i] == 0xdeadbeef) nFalse++;
+  }
+}
+
+
+// Append filter statistics, and wrapped table's columns
+
+void FilteredIndex::reportHeadings(std::ostream& csv) const {
+  csv << ", Filter Clock (s), Filter bits/key, Target FP"
+      << ", Rejected, Passed, False positive";
+  if (inner) headingsOf(inner, csv);
+}
+
+void FilteredIndex::reportColumns(std::ostream& csv) const {
+  objectId_t nKeys = tableSize + addedKeys.size();
+  double bitsPerKey = (filter && nKeys>0) ? 8.*filter->bytes()/nKeys : 0.;
+
+  csv << ", " << filterUsage.elapsed() << ", " << bitsPerKey
+      << ", " << fpRate << ", " << nRejected << ", " << nPassed
+      << ", " << nFalse;
+
+  if (inner) columnsOf(inner, csv);
+}
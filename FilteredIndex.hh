@@ -0,0 +1,68 @@
+#ifndef FILTERED_INDEX_HH
+#define FILTERED_INDEX_HH 1
+// $Id$
+// FilteredIndex.hh -- Approximate-membership filter (Bloom or xor) in
+// front of another lookup table, so that queries for absent objectIds
+// are rejected without reaching the (possibly remote) table.
+//
+// 20261017  Michael Kelsey
+// 20261017  Pass batches of filtered queries to table
+// 20261017  Skip updated objectIds already in table, so keys are unique
+
+#include "IndexTester.hh"
+#include <string>
+#include <vector>
+
+class KeyFilter;
+
+
+class FilteredIndex : public IndexTester {
+public:
+  enum Filter { Bloom, Xor };
+
+  // Takes ownership of wrapped table, which is deleted here
+  FilteredIndex(IndexTester* table, Filter type=Bloom, int verbose=0);
+  virtual ~FilteredIndex();
+
+  void setFalsePositiveRate(double fpr=0.01) { fpRate = fpr; }
+
+  static bool knownFilter(const std::string& name);	// "bloom" or "xor"
+  static Filter filterFromName(const std::string& name);
+
+protected:
+  virtual void create(objectId_t asize);
+  virtual void update(const char* datafile);
+  virtual chunkId_t value(objectId_t index);
+  virtual void values(const objectId_t* index, chunkId_t* chunk, size_t n);
+  virtual void cleanup();
+
+  virtual void reportHeadings(std::ostream& csv) const;
+  virtual void reportColumns(std::ostream& csv) const;
+
+  void buildFilter();				// All keys, including updates
+
+  bool inTable(objectId_t key) const {		// Generated by create()
+    return (indexStep>0 && key%indexStep == 0 && key/indexStep < tableSize);
+  }
+
+private:
+  IndexTester* inner;
+  Filter filterType;
+  double fpRate;
+  std::string fullName;				// Filter and table types
+  KeyFilter* filter;
+
+  std::vector<objectId_t> addedKeys;		// From bulk updates, sorted
+
+  std::vector<size_t> passPos;			// Batch positions sent to table
+  std::vector<objectId_t> passIndex;
+  std::vector<chunkId_t> passChunk;
+
+  long nRejected;				// Stopped by filter
+  long nPassed;					// Sent to table
+  long nFalse;					// Passed, but not found
+
+  UsageTimer filterUsage;			// Filter construction alone
+};
+
+#endif	/* FILTERED_INDEX_HH */
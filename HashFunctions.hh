@@ -0,0 +1,39 @@
+#ifndef HASH_FUNCTIONS_HH
+#define HASH_FUNCTIONS_HH 1
+// $Id$
+// HashFunctions.hh -- Inline hash functions for objectId keys, shared by
+// the hashed lookup tables.
+//
+// 20261017  Michael Kelsey
+// 20261017  Add seeded mixing function, for families of hashes
+
+#include "IndexTester.hh"
+#include <stdint.h>
+
+
+// Multiply-shift hash: high bits of product are well mixed, even for
+// evenly spaced keys (objectId*indexStep) whose low bits are constant
+
+inline uint64_t multiplyShift(objectId_t key) {
+  return key * 0x9E3779B97F4A7C15ULL;		// 2^64 / golden ratio, odd
+}
+
+
+// Seeded hash with all output bits well mixed (SplitMix64 finalizer);
+// different seeds give effectively independent hash functions
+
+inline uint64_t mix64(uint64_t key, uint64_t seed=0ULL) {
+  uint64_t z = key + (seed+1)*0x9E3779B97F4A7C15ULL;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+
+// Map a 64-bit hash uniformly onto [0,n) using its high bits
+
+inline uint64_t reduceRange(uint64_t hash, uint64_t n) {
+  return (uint64_t)(((unsigned __int128)hash * n) >> 64);
+}
+
+#endif	/* HASH_FUNCTIONS_HH */
@@ -0,0 +1,168 @@
+// $Id$
+// HashIndex.cc -- Exercise performance of flat open-addressing hash table
+// (SwissTable style, with 1-byte control tags) as lookup table.
+//
+// 20261017  Michael Kelsey
+
+#include "HashIndex.hh"
+#include <stdlib.h>
+#include <string.h>
+#include <cmath>
+#include <iostream>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+// Constructor and destructor
+
+HashIndex::HashIndex(int verbose)
+  : IndexTester("hash",verbose), maxLoad(0.875), nGroups(0ULL),
+    nEntries(0ULL), groups(0) {;}
+
+void HashIndex::cleanup() {
+  free(groups);				// Allocated with posix_memalign()
+  groups = 0;
+  nGroups = 0;
+  nEntries = 0;
+}
+
+
+// Storage cost per entry actually registered, including empty slots
+
+double HashIndex::bytesPerEntry() const {
+  return (nEntries>0 ? (double)nGroups*sizeof(Group)/nEntries : 0.);
+}
+
+
+// Populate table with full range of keys, all values zero
+
+void HashIndex::create(objectId_t asize) {
+  if (groups) cleanup();		// Avoid memory leaks
+  if (asize == 0) return;
+
+  if (maxLoad <= 0. || maxLoad > 1.) maxLoad = 0.875;	// Sanity check
+  nGroups = (uint64_t)ceil(asize / maxLoad / groupSize);
+
+  void* buf = 0;
+  if (posix_memalign(&buf, 64, nGroups*sizeof(Group)) != 0) {
+    std::cerr << "HashIndex unable to allocate " << nGroups << " groups"
+	      << std::endl;
+    nGroups = 0;
+    return;
+  }
+
+  groups = (Group*)buf;
+  for (uint64_t ig=0; ig<nGroups; ig++) {	// Only tags need to be set
+    memset(groups[ig].ctrl, emptyTag, groupSize);
+  }
+
+  if (verboseLevel>1) {
+    std::cout << "HashIndex " << nGroups << " groups for " << asize
+	      << " keys, " << nGroups*sizeof(Group)/1e6 << " MB" << std::endl;
+  }
+
+  for (objectId_t i=0; i<asize; i++) {
+    insert(i*indexStep, 0);
+  }
+}
+
+
+// Place key in first empty slot along probe sequence (no deletions)
+
+void HashIndex::insert(objectId_t key, chunkId_t chunk) {
+  uint64_t hash = multiplyShift(key);
+  uint8_t tag = tagOf(hash);
+  uint64_t ig = groupOf(hash);
+
+  for (uint64_t probe=1; probe<=nGroups; probe++) {
+    Group& grp = groups[ig];
+
+    unsigned match = matchTag(grp, tag);	// Replace existing key
+    for (; match; match &= match-1) {
+      Slot& slot = grp.slot[__builtin_ctz(match)];
+      if (slot.key == key) {
+	slot.chunk = chunk;
+	return;
+      }
+    }
+
+    unsigned empty = matchEmpty(grp);
+    if (empty) {
+      int islot = __builtin_ctz(empty);
+      grp.ctrl[islot] = tag;
+      grp.slot[islot].key = key;
+      grp.slot[islot].chunk = chunk;
+      nEntries++;
+      return;
+    }
+
+    if (++ig == nGroups) ig = 0;		// Linear probing by group
+  }
+
+  std::cerr << "HashIndex full, unable to insert " << key << std::endl;
+}
+
+
+// Return chunk only if index was registered
+
+chunkId_t HashIndex::value(objectId_t index) {
+  if (!groups) return 0xdeadbeef;	// Include sanity check
+
+  uint64_t hash = multiplyShift(index);
+  uint8_t tag = tagOf(hash);
+  uint64_t ig = groupOf(hash);
+
+  for (uint64_t probe=1; probe<=nGroups; probe++) {
+    const Group& grp = groups[ig];
+
+    unsigned match = matchTag(grp, tag);
+    for (; match; match &= match-1) {
+      const Slot& slot = grp.slot[__builtin_ctz(match)];
+      if (slot.key == index) return slot.chunk;
+    }
+
+    if (matchEmpty(grp)) break;		// Key would have been placed here
+
+    if (++ig == nGroups) ig = 0;
+  }
+
+  return 0xdeadbeef;
+}
+
+
+// Compare all control tags in group at once, one bit per matching slot
+
+unsigned HashIndex::matchTag(const Group& grp, uint8_t tag) const {
+#ifdef __SSE2__
+  __m128i ctrl = _mm_load_si128((const __m128i*)grp.ctrl);
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(tag)));
+#else
+  unsigned mask = 0;
+  for (int i=0; i<groupSize; i++) mask |= (grp.ctrl[i]==tag) << i;
+  return mask;
+#endif
+}
+
+unsigned HashIndex::matchEmpty(const Group& grp) const {
+#ifdef __SSE2__
+  __m128i ctrl = _mm_load_si128((const __m128i*)grp.ctrl);
+  return _mm_movemask_epi8(ctrl);		// High bit set only if empty
+#else
+  unsigned mask = 0;
+  for (int i=0; i<groupSize; i++) mask |= ((grp.ctrl[i]&emptyTag)!=0) << i;
+  return mask;
+#endif
+}
+
+
+// Append load factor and storage cost to CSV report
+
+void HashIndex::reportHeadings(std::ostream& csv) const {
+  csv << ", Load factor, Bytes/entry";
+}
+
+void HashIndex::reportColumns(std::ostream& csv) const {
+  double load = nGroups>0 ? (double)nEntries/(nGroups*groupSize) : 0.;
+  csv << ", " << load << ", " << bytesPerEntry();
+}
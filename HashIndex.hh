@@ -0,0 +1,68 @@
+#ifndef HASH_INDEX_HH
+#define HASH_INDEX_HH 1
+// $Id$
+// HashIndex.hh -- Exercise performance of flat open-addressing hash table
+// (SwissTable style, with 1-byte control tags) as lookup table.
+//
+// 20261017  Michael Kelsey
+
+#include "IndexTester.hh"
+#include "HashFunctions.hh"
+#include <stdint.h>
+#include <stddef.h>
+
+
+class HashIndex : public IndexTester {
+public:
+  HashIndex(int verbose=0);
+  virtual ~HashIndex() { cleanup(); }
+
+  // Maximum fraction of slots filled; table is sized from this
+  void setLoadFactor(double lf=0.875) { maxLoad = lf; }
+  double getLoadFactor() const { return maxLoad; }
+
+  double bytesPerEntry() const;
+
+protected:
+  virtual void create(objectId_t asize);
+  virtual chunkId_t value(objectId_t index);
+  virtual void cleanup();
+
+  virtual void reportHeadings(std::ostream& csv) const;
+  virtual void reportColumns(std::ostream& csv) const;
+
+  void insert(objectId_t key, chunkId_t chunk);
+
+  static const int groupSize = 16;	// Control tags probed together
+  static const uint8_t emptyTag = 0x80;	// Full slots have high bit clear
+
+  // Key and chunk side by side, so a hit reads one slot line after the
+  // control tags; 16-byte slots never straddle a cache line
+  struct Slot {
+    objectId_t key;
+    chunkId_t chunk;
+  };
+
+  // Group is padded to whole cache lines (320 bytes, 20 per slot), so
+  // every group in the array is aligned like the first
+  struct alignas(64) Group {
+    uint8_t ctrl[groupSize];		// Empty, or low 7 bits of hash
+    Slot slot[groupSize];
+  };
+
+  static_assert(sizeof(Group) % 64 == 0, "Group must fill cache lines");
+
+  unsigned matchTag(const Group& grp, uint8_t tag) const;   // Bit per slot
+  unsigned matchEmpty(const Group& grp) const;
+
+  uint64_t groupOf(uint64_t hash) const { return reduceRange(hash, nGroups); }
+  static uint8_t tagOf(uint64_t hash) { return (hash >> 25) & 0x7f; }
+
+private:
+  double maxLoad;
+  uint64_t nGroups;
+  objectId_t nEntries;
+  Group* groups;
+};
+
+#endif	/* HASH_INDEX_HH */
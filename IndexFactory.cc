@@ -0,0 +1,181 @@
+// $Id$
+// IndexFactory.cc -- Construct testing driver from type name, as described
+// in index-performance.cc; shared with index-server.
+//
+// 20261017  Michael Kelsey (moved getTester() from index-performance.cc)
+// 20261017  Add memcached bulk loading option
+// 20261017  Add mysql-prepared option
+// 20261017  Add mysql-parallel option
+
+#include "IndexFactory.hh"
+#include "ArrayIndex.hh"
+#include "BlockArrays.hh"
+#include "MapIndex.hh"
+#include "FileIndex.hh"
+#include "SortedIndex.hh"
+#include "HashIndex.hh"
+#include "LearnedIndex.hh"
+#include "IntervalIndex.hh"
+#include "BTreeIndex.hh"
+#include "EliasFanoIndex.hh"
+#include "PerfectHashIndex.hh"
+#include "FilteredIndex.hh"
+#include "ArtIndex.hh"
+#include "DiskBlockIndex.hh"
+#include "LsmIndex.hh"
+#include "NumaIndex.hh"
+#include "RemoteIndex.hh"
+#include <functional>
+#ifdef HAS_MEMCACHED
+#include "MemCDIndex.hh"
+#endif
+#ifdef HAS_XROOTD
+#include "XrootdSimple.hh"
+#endif
+#ifdef HAS_ROCKSDB
+#include "RocksIndex.hh"
+#endif
+#ifdef HAS_MYSQL
+#include "MysqlIndex.hh"
+#include "MysqlUpdate.hh"
+#endif
+#include <iostream>
+#include <string>
+using namespace std;
+
+
+// Get testing driver based on type name
+
+IndexTester* getTester(const string& type) {
+  size_t plus = type.find('+');		// Filter in front of table
+  if (plus != string::npos && FilteredIndex::knownFilter(type.substr(0,plus))) {
+    IndexTester* table = getTester(type.substr(plus+1));
+    if (!table) return 0;
+
+    return new FilteredIndex(table,
+			     FilteredIndex::filterFromName(type.substr(0,plus)));
+  }
+
+  if (plus != string::npos && NumaIndex::knownMode(type.substr(0,plus))) {
+    string inner = type.substr(plus+1);
+    IndexTester* table = getTester(inner);	// Check that type is valid
+    if (!table) return 0;
+    delete table;
+
+    return new NumaIndex(std::bind(getTester, inner),
+			 NumaIndex::modeFromName(type.substr(0,plus)));
+  }
+
+  if (plus != string::npos &&
+      RemoteIndex::knownTransport(type.substr(0,plus))) {
+    string inner = type.substr(plus+1);
+    IndexTester* table = getTester(inner);	// Check that type is valid
+    if (!table) return 0;
+    delete table;
+
+    return new RemoteIndex(std::bind(getTester, inner),
+		   RemoteIndex::transportFromName(type.substr(0,plus)));
+  }
+
+  PagePolicy pages = pagePolicyFromName(type);	// For in-memory arrays
+  bool setPages = (pages != SmallPages || type.find("small") != string::npos);
+
+  switch (type[0]) {
+  case 'a': {
+    if (type[1] == 'r' && type[2] == 't') return new ArtIndex;
+    ArrayIndex* array = new ArrayIndex;
+    array->setPagePolicy(pages);
+    array->setPacked(type.find("packed") != string::npos);
+    return array;
+  } break;
+  case 'b':
+    if (type[1] == 't') {
+      bool prefetch = (type.find("prefetch") != string::npos);
+      if (type.find("8") != string::npos) {
+	BTreeIndex<8>* btree = new BTreeIndex<8>;
+	btree->setPrefetch(prefetch);
+	if (setPages) btree->setPagePolicy(pages);
+	return btree;
+      } else {
+	BTreeIndex<16>* btree = new BTreeIndex<16>;
+	btree->setPrefetch(prefetch);
+	if (setPages) btree->setPagePolicy(pages);
+	return btree;
+      }
+    } else {
+      BlockArrays* blocks = new BlockArrays;
+      blocks->setPagePolicy(pages);
+      blocks->setPacked(type.find("packed") != string::npos);
+      return blocks;
+    } break;
+  case 'd': {
+    DiskBlockIndex* disk = new DiskBlockIndex;
+    disk->setDirect(type.find("direct") != string::npos);
+    return disk;
+  } break;
+  case 'e': return new EliasFanoIndex; break;
+  case 'f': {
+    FileIndex* file = new FileIndex;
+    file->configure(type);
+    return file;
+  } break;
+  case 'h': return new HashIndex; break;
+  case 'i': return new IntervalIndex; break;
+  case 'l':
+    if (type[1] == 's') {
+      LsmIndex* lsm = new LsmIndex;
+      if (type.find("mixed") != string::npos) lsm->setWriteFraction(0.5);
+      return lsm;
+    }
+    return new LearnedIndex; break;
+  case 'm':
+    switch (type[1]) {
+#ifdef HAS_MEMCACHED
+    case 'e': {
+      MemCDIndex* memcd = new MemCDIndex;
+      if (type.find("bulk") != string::npos) memcd->setBulkLoad();
+      return memcd;
+    } break;
+#endif
+#ifdef HAS_MYSQL
+    case 'y': {
+      MysqlIndex* mysql = new MysqlIndex;
+      mysql->setTableSize(40e6);
+      if (type.find("prepared") != string::npos) mysql->setPrepared();
+      if (type.find("parallel") != string::npos) mysql->setParallelLoad();
+      return mysql;
+    } break;
+#endif
+    case 'p': return new PerfectHashIndex; break;
+    default: break;
+    } break;
+#ifdef HAS_ROCKSDB
+  case 'r': return new RocksIndex; break;
+#endif
+  case 's':
+    switch (type[1]) {
+    case 'o': {
+      SortedIndex* sorted = new SortedIndex;
+      sorted->setKernel(SortedIndex::kernelFromName(type.c_str()));
+      sorted->setPacked(type.find("packed") != string::npos);
+      return sorted;
+    } break;
+    default: return new MapIndex; break;
+    } break;
+#ifdef HAS_MYSQL
+  case 'u': {
+    MysqlUpdate* umysql = new MysqlUpdate;
+    umysql->setTableSize(4e6);		// Small blocks to test bulk split
+    return umysql;
+  } break;
+#endif
+#ifdef HAS_XROOTD
+  case 'x': return new XrootdSimple; break;
+#endif
+  default: break;
+  }
+
+  // Falls through if nothing matched
+  cerr << "ERROR: unknown indexing type " << type << endl;
+  return 0;
+}
@@ -0,0 +1,15 @@
+#ifndef INDEX_FACTORY_HH
+#define INDEX_FACTORY_HH 1
+// $Id$
+// IndexFactory.hh -- Construct testing driver from type name, as described
+// in index-performance.cc; shared with index-server.
+//
+// 20261017  Michael Kelsey (moved getTester() from index-performance.cc)
+
+#include "IndexTester.hh"
+#include <string>
+
+// Returns null (with error message) if type is not known or not built
+IndexTester* getTester(const std::string& type);
+
+#endif	/* INDEX_FACTORY_HH */
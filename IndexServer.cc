@@ -0,0 +1,316 @@
+// $Id$
+// IndexServer.cc -- Serve objectId to chunk lookups from any lookup table
+// over TCP or Unix sockets, using epoll() for many client connections.
+//
+// 20261017  Michael Kelsey
+// 20261017  Reuse request key buffer
+// 20261017  Compact sent replies; stop reading while replies back up
+
+#include "IndexServer.hh"
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <iostream>
+
+
+// Constructor and destructor
+
+IndexServer::IndexServer(IndexTester* t, int verbose)
+  : table(t), verboseLevel(verbose), listenFd(-1), epollFd(-1), stopFd(-1),
+    nRequests(0), nLookups(0) {
+  epollFd = epoll_create1(EPOLL_CLOEXEC);
+  stopFd = eventfd(0, EFD_NONBLOCK|EFD_CLOEXEC);
+
+  epoll_event ev;
+  ev.events = EPOLLIN;
+  ev.data.fd = stopFd;
+  epoll_ctl(epollFd, EPOLL_CTL_ADD, stopFd, &ev);
+}
+
+IndexServer::~IndexServer() {
+  while (!clients.empty()) drop(clients.begin()->first);
+
+  if (listenFd >= 0) close(listenFd);
+  if (!unixPath.empty()) unlink(unixPath.c_str());
+
+  close(stopFd);
+  close(epollFd);
+}
+
+
+// Open listening socket; an existing Unix socket file is replaced
+
+bool IndexServer::listen(const std::string& address) {
+  if (listenFd >= 0) {
+    std::cerr << "IndexServer already listening" << std::endl;
+    return false;
+  }
+
+  if (address.compare(0, 5, "unix:") == 0) {
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    unixPath = address.substr(5);
+    if (unixPath.empty() || unixPath.size() >= sizeof(addr.sun_path)) {
+      std::cerr << "IndexServer invalid socket path " << unixPath << std::endl;
+      unixPath.clear();
+      return false;
+    }
+    strcpy(addr.sun_path, unixPath.c_str());
+    unlink(unixPath.c_str());
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM|SOCK_CLOEXEC, 0);
+    if (listenFd >= 0 && bind(listenFd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+      close(listenFd);
+      listenFd = -1;
+    }
+  } else if (address.compare(0, 4, "tcp:") == 0) {
+    std::string host, port = address.substr(4);
+    size_t colon = port.rfind(':');
+    if (colon != std::string::npos) {
+      host = port.substr(0, colon);
+      port = port.substr(colon+1);
+    }
+
+    addrinfo hints, *found = 0;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    if (getaddrinfo(host.empty() ? 0 : host.c_str(), port.c_str(), &hints,
+		    &found) != 0) found = 0;
+
+    for (addrinfo* ai=found; ai && listenFd<0; ai=ai->ai_next) {
+      listenFd = socket(ai->ai_family, ai->ai_socktype|SOCK_CLOEXEC,
+			ai->ai_protocol);
+      if (listenFd < 0) continue;
+
+      int on = 1;
+      setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+      if (bind(listenFd, ai->ai_addr, ai->ai_addrlen) < 0) {
+	close(listenFd);
+	listenFd = -1;
+      }
+    }
+    if (found) freeaddrinfo(found);
+  }
+
+  if (listenFd < 0 || ::listen(listenFd, SOMAXCONN) < 0) {
+    std::cerr << "IndexServer unable to listen on " << address << ": "
+	      << strerror(errno) << std::endl;
+    if (listenFd >= 0) close(listenFd);
+    listenFd = -1;
+    return false;
+  }
+
+  fcntl(listenFd, F_SETFL, fcntl(listenFd, F_GETFL) | O_NONBLOCK);
+
+  epoll_event ev;
+  ev.events = EPOLLIN;
+  ev.data.fd = listenFd;
+  epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &ev);
+
+  if (verboseLevel>1)
+    std::cout << "IndexServer listening on " << address << std::endl;
+
+  return true;
+}
+
+
+unsigned IndexServer::port() const {
+  sockaddr_storage addr;
+  socklen_t length = sizeof(addr);
+  if (listenFd < 0 || getsockname(listenFd, (sockaddr*)&addr, &length) < 0)
+    return 0;
+
+  if (addr.ss_family == AF_INET) return ntohs(((sockaddr_in&)addr).sin_port);
+  if (addr.ss_family == AF_INET6)
+    return ntohs(((sockaddr_in6&)addr).sin6_port);
+
+  return 0;
+}
+
+
+// Event loop:  new connections, incoming requests and pending replies
+
+void IndexServer::serve() {
+  const int maxEvents = 64;
+  epoll_event events[maxEvents];
+
+  while (true) {
+    int n = epoll_wait(epollFd, events, maxEvents, -1);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      std::cerr << "IndexServer epoll_wait: " << strerror(errno) << std::endl;
+      return;
+    }
+
+    for (int i=0; i<n; i++) {
+      int fd = events[i].data.fd;
+      if (fd == stopFd) {
+	uint64_t count;
+	if (read(stopFd, &count, sizeof(count)) < 0) {;}	// Reset
+	return;
+      }
+
+      if (fd == listenFd) {
+	accept();
+	continue;
+      }
+
+      std::map<int, Client>::iterator client = clients.find(fd);
+      if (client == clients.end()) continue;
+
+      bool open = !(events[i].events & (EPOLLERR|EPOLLHUP)) ||
+	(events[i].events & EPOLLIN);
+      if (open && (events[i].events & EPOLLIN))
+	open = receive(fd, client->second);
+      if (open) open = transmit(fd, client->second);
+
+      if (!open) drop(fd);
+    }
+  }
+}
+
+void IndexServer::stop() {
+  uint64_t one = 1;
+  if (write(stopFd, &one, sizeof(one)) < 0) {;}	// Nothing to be done
+}
+
+
+// Accept all pending connections
+
+void IndexServer::accept() {
+  while (true) {
+    int fd = accept4(listenFd, 0, 0, SOCK_NONBLOCK|SOCK_CLOEXEC);
+    if (fd < 0) return;			// EAGAIN, or client went away
+
+    int on = 1;				// Fails harmlessly on Unix socket
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+    epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev);
+
+    clients[fd].sent = 0;
+    clients[fd].events = EPOLLIN;
+
+    if (verboseLevel>1) std::cout << "IndexServer client " << fd << std::endl;
+  }
+}
+
+void IndexServer::drop(int fd) {
+  epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, 0);
+  close(fd);
+  clients.erase(fd);
+
+  if (verboseLevel>1) std::cout << "IndexServer closed " << fd << std::endl;
+}
+
+
+// Read what is available, answering complete requests as they arrive,
+// until too many replies are waiting to be sent
+
+bool IndexServer::receive(int fd, Client& client) {
+  char buffer[65536];
+  while (client.output.size() - client.sent <= maxOutput) {
+    ssize_t nread = read(fd, buffer, sizeof(buffer));
+    if (nread > 0) {
+      client.input.insert(client.input.end(), buffer, buffer+nread);
+      if (!process(client)) return false;
+      continue;
+    }
+
+    if (nread == 0) return false;		// Client closed connection
+    if (errno == EINTR) continue;
+    if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+    return false;
+  }
+
+  return true;
+}
+
+bool IndexServer::process(Client& client) {
+  size_t used = 0;
+  while (client.input.size() - used >= sizeof(uint32_t)) {
+    uint32_t n;
+    memcpy(&n, &client.input[used], sizeof(n));
+    if (n > maxRequest) {
+      std::cerr << "IndexServer request for " << n << " lookups refused"
+		<< std::endl;
+      return false;
+    }
+
+    size_t length = sizeof(uint32_t) + n*sizeof(objectId_t);
+    if (client.input.size() - used < length) break;	// Incomplete
+
+    keys.resize(n);
+    memcpy(keys.data(), &client.input[used+sizeof(uint32_t)],
+	   n*sizeof(objectId_t));
+
+    chunks.resize(n);
+    table->Lookup(keys.data(), chunks.data(), n);
+
+    const char* reply = (const char*)chunks.data();
+    client.output.insert(client.output.end(), reply,
+			 reply+n*sizeof(chunkId_t));
+
+    used += length;
+    nRequests++;
+    nLookups += n;
+  }
+
+  client.input.erase(client.input.begin(), client.input.begin()+used);
+  return true;
+}
+
+
+// Write as much reply as socket will take; wait for EPOLLOUT if not all,
+// and stop reading requests while too much is waiting to be sent
+
+bool IndexServer::transmit(int fd, Client& client) {
+  while (client.sent < client.output.size()) {
+    ssize_t nsent = write(fd, &client.output[client.sent],
+			  client.output.size()-client.sent);
+    if (nsent > 0) {
+      client.sent += nsent;
+      continue;
+    }
+
+    if (nsent < 0 && errno == EINTR) continue;
+    if (nsent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+    return false;
+  }
+
+  size_t pending = client.output.size() - client.sent;
+  if (pending == 0) {
+    client.output.clear();
+    client.sent = 0;
+  } else if (client.sent >= pending) {		// Discard sent half or more
+    client.output.erase(client.output.begin(),
+			client.output.begin()+client.sent);
+    client.sent = 0;
+  }
+
+  uint32_t events = (pending > maxOutput) ? 0 : EPOLLIN;
+  if (pending > 0) events |= EPOLLOUT;
+
+  if (events != client.events) {
+    epoll_event ev;
+    ev.events = events;
+    ev.data.fd = fd;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &ev);
+    client.events = events;
+  }
+
+  return true;
+}
@@ -0,0 +1,71 @@
+#ifndef INDEX_SERVER_HH
+#define INDEX_SERVER_HH 1
+// $Id$
+// IndexServer.hh -- Serve objectId to chunk lookups from any lookup table
+// over TCP or Unix sockets, using epoll() for many client connections.
+//
+// Each request is a 32-bit count N followed by N 64-bit objectIds; the
+// reply is N 32-bit chunkIds, in the same order.  All values are in host
+// byte order, so client and server must have the same architecture.
+//
+// 20261017  Michael Kelsey
+// 20261017  Reuse request key buffer
+// 20261017  Compact sent replies; stop reading while replies back up
+
+#include "IndexTester.hh"
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+
+class IndexServer {
+public:
+  IndexServer(IndexTester* table, int verbose=0);	// Table is not owned
+  ~IndexServer();
+
+  // Address is "unix:<path>", "tcp:<port>" or "tcp:<host>:<port>"
+  bool listen(const std::string& address);
+  unsigned port() const;		// Bound TCP port, zero for Unix
+
+  void serve();				// Runs until stop() is called
+  void stop();				// Safe from signal handlers
+
+  static const uint32_t maxRequest = 1U<<20;	// Larger closes connection
+  static const size_t maxOutput = 1U<<24;	// Unsent bytes; stop reading
+
+  long requests() const { return nRequests; }
+  long lookups() const { return nLookups; }
+
+protected:
+  struct Client {
+    std::vector<char> input;		// Partial requests
+    std::vector<char> output;		// Replies not yet sent
+    size_t sent;			// Bytes of output already written
+    uint32_t events;			// Registered with epoll
+  };
+
+  void accept();
+  bool receive(int fd, Client& client);	// False if client closed
+  bool transmit(int fd, Client& client);
+  bool process(Client& client);		// False if request is too large
+  void drop(int fd);
+
+private:
+  IndexTester* table;
+  int verboseLevel;
+
+  int listenFd;
+  int epollFd;
+  int stopFd;				// eventfd, written by stop()
+  std::string unixPath;			// Removed when server is deleted
+
+  std::map<int, Client> clients;
+  std::vector<objectId_t> keys;		// Aligned copy of one request
+  std::vector<chunkId_t> chunks;	// Reply buffer for one request
+
+  long nRequests;
+  long nLookups;
+};
+
+#endif	/* INDEX_SERVER_HH */
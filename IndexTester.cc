@@ -5,21 +5,27 @@
 // 20151023  Michael Kelsey
 // 20151102  Add missing #includes reported by GCC 4.8.2
 // 20160216  Add interface and optional subclass function for bulk updates
+// 20261017  Append subclass columns to CSV output
+// 20261017  Generate queries for absent objectIds on request
+// 20261017  Exercise table with batches of queries on request
 
 #include "IndexTester.hh"
 #include <limits.h>
 #include <stdlib.h>
 #include <iostream>
+#include <vector>
 
 
 // Constructor
 
 IndexTester::IndexTester(const char* name, int verbose) :
-  verboseLevel(verbose), tableSize(0ULL), indexStep(1), tableName(name),
+  verboseLevel(verbose), tableSize(0ULL), indexStep(1), missFraction(0.),
+  batchSize(1), tableName(name),
   lastTrials(0L) {;}
 
 
-// Generate random index spanning full size of table
+// Generate random index spanning full size of table; absent IDs are
+// between the sparsified values, or past the end of a dense table
 
 objectId_t IndexTester::randomIndex() const {
   objectId_t rval = 0ULL;
@@ -27,6 +33,11 @@ objectId_t IndexTester::randomIndex() const {
   if (tableSize < LONG_MAX) rval = random()%tableSize;	// random() uses LONG
   else rval = (random()*ULONG_MAX + random()) % tableSize;
 
+  if (missFraction > 0. && random() < missFraction*RAND_MAX) {
+    if (indexStep > 1) return rval*indexStep + 1 + random()%(indexStep-1);
+    return tableSize + rval;
+  }
+
   return rval*indexStep;	// Sparsify random values
 }
 
@@ -63,6 +74,14 @@ void IndexTester::UpdateTable(const char* datafile) {
 }
 
 
+// Default batch lookup, one key at a time
+
+void IndexTester::values(const objectId_t* index, chunkId_t* chunk,
+			 size_t n) {
+  for (size_t i=0; i<n; i++) chunk[i] = value(index[i]);
+}
+
+
 // Multiple random accesses on table, collecting performance statistics
 
 void IndexTester::ExerciseTable(long ntrials) {
@@ -71,11 +90,22 @@ void IndexTester::ExerciseTable(long ntrials) {
   objectId_t idx;
   chunkId_t val;
 
+  std::vector<objectId_t> idxBatch(batchSize);
+  std::vector<chunkId_t> valBatch(batchSize);
+
   usage.zero();
   usage.start();
-  for (long i=0; i<ntrials; i++) {
-    idx = randomIndex();
-    val = value(idx);
+  if (batchSize > 1) {
+    for (long i=0; i<ntrials; i+=batchSize) {
+      size_t n = (ntrials-i < (long)batchSize) ? ntrials-i : batchSize;
+      for (size_t j=0; j<n; j++) idxBatch[j] = randomIndex();
+      values(&idxBatch[0], &valBatch[0], n);
+    }
+  } else {
+    for (long i=0; i<ntrials; i++) {
+      idx = randomIndex();
+      val = value(idx);
+    }
   }
   usage.end();
 
@@ -92,7 +122,9 @@ void IndexTester::TestAndReport(objectId_t asize, long ntrials,
   if (asize == 0) {		// Special case: print column headings
     csv << "Type, Size (1e6), Init CPU (s), Init Clock (s)"
 	<< ", Accesses (1e6), Run CPU (s), Run Clock (s)"
-	<< ", Memory (MB), Page fault, Input op" << std::endl;
+	<< ", Memory (MB), Page fault, Input op";
+    reportHeadings(csv);
+    csv << std::endl;
     return;
   }
 
@@ -104,8 +136,9 @@ void IndexTester::TestAndReport(objectId_t asize, long ntrials,
   ExerciseTable(ntrials);
   csv << ", " << lastTrials/1e6 << ", " << usage.cpuTime()
       << ", " << usage.elapsed() << ", " << usage.maxMemory()/1e6 << ", "
-      << usage.pageFaults() << ", " << usage.ioInput()
-      << std::endl;
+      << usage.pageFaults() << ", " << usage.ioInput();
+  reportColumns(csv);
+  csv << std::endl;
 
   cleanup();			// Remove job-specific data before next pass
 }
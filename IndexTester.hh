@@ -9,8 +9,16 @@
 // 20160216  Add interface and optional subclass function for bulk updates
 // 20160217  FINALLY:  Provide typedefs for "objectId_t" and "chunkId_t"
 // 20160224  Add protected cleanup() function to be used by subclasses
+// 20261017  Allow subclasses to change name (for CSV) with configuration
+// 20261017  Add optional subclass functions to append columns to CSV
+// 20261017  Add fraction of queries for absent objectIds; allow decorators
+// 20261017  Add batched lookups, with optional subclass function
+// 20261017  Allow NUMA decorator to call wrapped table's functions
+// 20261017  Allow network server to call table's lookup functions
+// 20261017  Replace friend classes with public batch lookup, static forwarders
 
 #include "UsageTimer.hh"
+#include <stddef.h>
 #include <iosfwd>
 
 // Use these everywhere for abstraction/convenience
@@ -31,6 +39,14 @@ public:
   void SetIndexSpacing(unsigned step=1) { indexStep = step; }
   unsigned GetIndexSpacing() const { return indexStep; }
 
+  // Fraction of random queries for objectIds not in table (negative lookup)
+  void SetMissFraction(double frac=0.) { missFraction = frac; }
+  double GetMissFraction() const { return missFraction; }
+
+  // Number of random queries passed to table together
+  void SetBatchSize(unsigned n=1) { batchSize = (n>0) ? n : 1; }
+  unsigned GetBatchSize() const { return batchSize; }
+
   // Generate test and print comma-separated data; asize=0 for column headings
   virtual void TestAndReport(objectId_t asize, long ntrials, std::ostream& csv);
 
@@ -39,6 +55,11 @@ public:
   void ExerciseTable(long ntrials);
   const UsageTimer& GetUsage() const { return usage; }
 
+  // Look up a batch of keys directly, without timing (for network server)
+  void Lookup(const objectId_t* index, chunkId_t* chunk, size_t n) {
+    values(index, chunk, n);
+  }
+
 protected:
   // Subclass must implement their own specific table creator and accessor
   virtual void create(objectId_t asize) = 0;
@@ -47,11 +68,36 @@ protected:
 
   virtual chunkId_t value(objectId_t index) = 0;
 
+  // Subclass may look up a batch of keys together (default is one by one)
+  virtual void values(const objectId_t* index, chunkId_t* chunk, size_t n);
+
+  // Subclass may append its own data to each CSV line (leading comma)
+  virtual void reportHeadings(std::ostream& csv) const {;}
+  virtual void reportColumns(std::ostream& csv) const {;}
+
   objectId_t randomIndex() const;
 
+  void SetName(const char* name) { tableName = name; }	// Not copied!
+
   int verboseLevel;		// For informational messages
   objectId_t tableSize;		// Used to generate random indices
   unsigned indexStep;		// Interval for generating object IDs
+  double missFraction;		// Fraction of queries for absent IDs
+  unsigned batchSize;		// Queries passed to values() together
+
+  // Decorators call wrapped table's functions through these
+  static chunkId_t valueOf(IndexTester* t, objectId_t index) {
+    return t->value(index);
+  }
+  static void valuesOf(IndexTester* t, const objectId_t* index,
+		       chunkId_t* chunk, size_t n) { t->values(index, chunk, n); }
+  static void cleanupOf(IndexTester* t) { t->cleanup(); }
+  static void headingsOf(const IndexTester* t, std::ostream& csv) {
+    t->reportHeadings(csv);
+  }
+  static void columnsOf(const IndexTester* t, std::ostream& csv) {
+    t->reportColumns(csv);
+  }
 
 private:
   const char* tableName;	// For writing CSV output
@@ -0,0 +1,139 @@
+// $Id$
+// IntervalIndex.cc -- Exercise performance of run-length intervals of
+// objectIds, one per chunk run, as lookup table.  Objects outside of
+// their run ("stragglers") are stored separately as exceptions.
+//
+// 20261017  Michael Kelsey
+
+#include "IntervalIndex.hh"
+#include "SearchKernels.hh"
+#include <iostream>
+#include <vector>
+
+
+// Constructor and destructor
+
+IntervalIndex::IntervalIndex(int verbose)
+  : IndexTester("interval",verbose), maxStraggle(2), nObjects(0ULL),
+    lastObject(0ULL), lastCount(0ULL) {;}
+
+void IntervalIndex::cleanup() {
+  // NOTE:  clear() does not release memory; swap with empty vector does
+  std::vector<objectId_t>().swap(runStart);
+  std::vector<chunkId_t>().swap(runChunk);
+  std::vector<objectId_t>().swap(excObject);
+  std::vector<chunkId_t>().swap(excChunk);
+  pending.clear();
+
+  nObjects = lastObject = lastCount = 0;
+}
+
+
+// Configure generated data: mean objects per run, fraction of stragglers
+
+void IntervalIndex::setClustering(objectId_t meanRun, double straggle) {
+  chunkGen.setMeanRun(meanRun);
+  chunkGen.setStragglerFraction(straggle);
+}
+
+
+// Generate clustered chunk assignments for full range of keys
+
+void IntervalIndex::create(objectId_t asize) {
+  cleanup();				// Discard previous table
+  if (asize == 0) return;
+
+  chunkGen.reset();			// Same data for every test size
+  for (objectId_t i=0; i<asize; i++) {
+    addObject(i*indexStep, chunkGen.next());
+  }
+
+  pending.clear();
+
+  if (verboseLevel>1) {
+    std::cout << "IntervalIndex " << nObjects << " objects in "
+	      << runStart.size() << " runs, " << excObject.size()
+	      << " exceptions" << std::endl;
+  }
+}
+
+
+// Extend current run, start a new one, or fold a short run into the
+// run surrounding it (objects must be added in increasing order)
+
+void IntervalIndex::addObject(objectId_t objID, chunkId_t chunk) {
+  nObjects++;
+  lastObject = objID;
+
+  if (!runStart.empty() && chunk == (runChunk.back() & ~hasExceptions)) {
+    lastCount++;
+    if (lastCount <= maxStraggle) pending.push_back(objID);
+    else pending.clear();
+    return;
+  }
+
+  size_t nRuns = runStart.size();
+  if (nRuns > 1 && lastCount <= maxStraggle &&
+      chunk == (runChunk[nRuns-2] & ~hasExceptions)) {
+    for (size_t i=0; i<pending.size(); i++) {	// Short run is stragglers
+      excObject.push_back(pending[i]);
+      excChunk.push_back(runChunk.back());
+    }
+
+    runStart.pop_back();
+    runChunk.pop_back();
+    runChunk.back() |= hasExceptions;
+
+    lastCount = maxStraggle+1;		// Resume surrounding run
+    pending.clear();
+    return;
+  }
+
+  runStart.push_back(objID);
+  runChunk.push_back(chunk);
+  lastCount = 1;
+  pending.assign(1, objID);
+}
+
+
+// Find run containing index, check exceptions only if run has them.
+// NOTE:  Unregistered indices inside a run's range return its chunk.
+
+chunkId_t IntervalIndex::value(objectId_t index) {
+  if (runStart.empty() || index > lastObject || index < runStart[0])
+    return 0xdeadbeef;
+
+  objectId_t irun = branchlessLowerBound(&runStart[0], runStart.size(),
+					 index+1) - 1;
+  chunkId_t chunk = runChunk[irun];
+  if (chunk & hasExceptions) {
+    objectId_t iexc = branchlessLowerBound(&excObject[0], excObject.size(),
+					   index);
+    if (iexc < excObject.size() && excObject[iexc] == index)
+      return excChunk[iexc];
+  }
+
+  return chunk & ~hasExceptions;
+}
+
+
+// Storage cost per entry registered
+
+double IntervalIndex::bytesPerEntry() const {
+  if (nObjects == 0) return 0.;
+
+  size_t entry = sizeof(objectId_t) + sizeof(chunkId_t);
+  return (double)(runStart.size()+excObject.size())*entry / nObjects;
+}
+
+
+// Append run counts and storage cost to CSV report
+
+void IntervalIndex::reportHeadings(std::ostream& csv) const {
+  csv << ", Runs, Exceptions, Bytes/entry";
+}
+
+void IntervalIndex::reportColumns(std::ostream& csv) const {
+  csv << ", " << runStart.size() << ", " << excObject.size()
+      << ", " << bytesPerEntry();
+}
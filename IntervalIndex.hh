@@ -0,0 +1,54 @@
+#ifndef INTERVAL_INDEX_HH
+#define INTERVAL_INDEX_HH 1
+// $Id$
+// IntervalIndex.hh -- Exercise performance of run-length intervals of
+// objectIds, one per chunk run, as lookup table.  Objects outside of
+// their run ("stragglers") are stored separately as exceptions.
+//
+// 20261017  Michael Kelsey
+
+#include "IndexTester.hh"
+#include "ChunkGenerator.hh"
+#include <vector>
+
+
+class IntervalIndex : public IndexTester {
+public:
+  IntervalIndex(int verbose=0);
+  virtual ~IntervalIndex() { cleanup(); }
+
+  // Configure generated data: mean objects per run, fraction of stragglers
+  void setClustering(objectId_t meanRun, double straggle);
+
+  // Shortest run which may be folded into the run surrounding it
+  void setMaxStraggle(objectId_t count=2) { maxStraggle = count; }
+
+  double bytesPerEntry() const;
+
+protected:
+  virtual void create(objectId_t asize);
+  virtual chunkId_t value(objectId_t index);
+  virtual void cleanup();
+
+  virtual void reportHeadings(std::ostream& csv) const;
+  virtual void reportColumns(std::ostream& csv) const;
+
+  void addObject(objectId_t objID, chunkId_t chunk);
+
+  static const chunkId_t hasExceptions = 0x80000000;	// Flag on run chunk
+
+private:
+  ChunkGenerator chunkGen;
+  objectId_t maxStraggle;
+  objectId_t nObjects;
+  objectId_t lastObject;
+  objectId_t lastCount;			// Objects in current (last) run
+  std::vector<objectId_t> pending;	// Objects of run, while still short
+
+  std::vector<objectId_t> runStart;	// First objectId in each run
+  std::vector<chunkId_t> runChunk;	// Chunk, with flag for exceptions
+  std::vector<objectId_t> excObject;	// Stragglers, in sorted order
+  std::vector<chunkId_t> excChunk;
+};
+
+#endif	/* INTERVAL_INDEX_HH */
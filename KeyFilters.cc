@@ -0,0 +1,161 @@
+// $Id$
+// KeyFilters.cc -- Approximate-membership filters over objectIds, which
+// may report false positives but never false negatives.
+//
+// 20261017  Michael Kelsey
+// 20261017  Build from generated keys, rather than a copy of key set
+// 20261017  Xor filter passes every key if construction fails
+
+#include "KeyFilters.hh"
+#include "HashFunctions.hh"
+#include <cmath>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+
+// Blocked Bloom filter sized for number of keys and false positive rate;
+// blocking costs a little accuracy, compensated with extra bits
+
+void BloomFilter::reserve(uint64_t nkeys) {
+  if (fpr <= 0. || fpr >= 1.) fpr = 0.01;	// Sanity check
+
+  double bitsPerKey = -1.44 * log2(fpr) * 1.1;
+  nHashes = (unsigned)lround(bitsPerKey * log(2.) / 1.1);
+  if (nHashes < 1) nHashes = 1;
+  if (nHashes > 16) nHashes = 16;
+
+  nBlocks = (uint64_t)ceil(nkeys * bitsPerKey / 512.);
+  if (nBlocks == 0) nBlocks = 1;
+
+  blocks.assign(nBlocks*8, 0ULL);
+}
+
+void BloomFilter::build(uint64_t nkeys, const KeySource& key) {
+  reserve(nkeys);
+  for (uint64_t k=0; k<nkeys; k++) insert(key(k));
+}
+
+// Block chosen by high bits of hash, bits within block by double hashing
+
+void BloomFilter::insert(objectId_t key) {
+  uint64_t hash = mix64(key);
+  uint64_t* block = &blocks[reduceRange(hash, nBlocks)*8];
+
+  uint32_t h1 = (uint32_t)hash, h2 = (uint32_t)(hash >> 32) | 1;
+  for (unsigned i=0; i<nHashes; i++, h1+=h2) {
+    block[(h1>>6) & 7] |= 1ULL << (h1&63);
+  }
+}
+
+bool BloomFilter::contains(objectId_t key) const {
+  if (blocks.empty()) return false;
+
+  uint64_t hash = mix64(key);
+  const uint64_t* block = &blocks[reduceRange(hash, nBlocks)*8];
+
+  uint32_t h1 = (uint32_t)hash, h2 = (uint32_t)(hash >> 32) | 1;
+  for (unsigned i=0; i<nHashes; i++, h1+=h2) {
+    if (!(block[(h1>>6) & 7] & (1ULL << (h1&63)))) return false;
+  }
+
+  return true;
+}
+
+
+// Xor filter fingerprint width set by false positive rate
+
+XorFilter::XorFilter(double fpRate)
+  : seed(0ULL), failed(false), segment(0ULL) {
+  if (fpRate <= 0. || fpRate >= 1.) fpRate = 0.01;	// Sanity check
+
+  fpBits = (unsigned)ceil(-log2(fpRate));
+  if (fpBits < 1) fpBits = 1;
+  if (fpBits > 32) fpBits = 32;
+}
+
+uint64_t XorFilter::slot(uint64_t hash, int i) const {
+  uint64_t rotated = (hash << (21*i)) | (hash >> ((64-21*i) & 63));
+  return i*segment + reduceRange(rotated, segment);
+}
+
+
+// Construction may fail (cycle in hypergraph, or duplicate keys); retry
+// with new seed, and if all fail, pass every key rather than none
+
+void XorFilter::build(uint64_t nkeys, const KeySource& key) {
+  failed = false;
+  for (int attempt=0; attempt<100; attempt++) {
+    seed++;
+    if (tryBuild(nkeys, key)) return;
+  }
+
+  std::cerr << "XorFilter unable to build filter for " << nkeys
+	    << " keys; passing all queries" << std::endl;
+  table.clear();
+  failed = true;
+}
+
+bool XorFilter::tryBuild(uint64_t nkeys, const KeySource& key) {
+  segment = (uint64_t)(1.23*nkeys)/3 + 32;
+
+  // Each table entry counts its keys, and the xor of those keys
+  std::vector<uint32_t> count(3*segment, 0U);
+  std::vector<objectId_t> xorKeys(3*segment, 0ULL);
+  for (uint64_t k=0; k<nkeys; k++) {
+    objectId_t id = key(k);
+    uint64_t hash = mix64(id, seed);
+    for (int i=0; i<3; i++) {
+      uint64_t is = slot(hash, i);
+      count[is]++;
+      xorKeys[is] ^= id;
+    }
+  }
+
+  // Peel entries with one key, which then assign that key's fingerprint
+  std::vector<uint64_t> queue;
+  for (uint64_t is=0; is<count.size(); is++) {
+    if (count[is] == 1) queue.push_back(is);
+  }
+
+  std::vector<std::pair<objectId_t,uint64_t> > order;	// Key, and entry
+  order.reserve(nkeys);
+  while (!queue.empty()) {
+    uint64_t is = queue.back();
+    queue.pop_back();
+    if (count[is] != 1) continue;
+
+    objectId_t key = xorKeys[is];
+    order.push_back(std::make_pair(key, is));
+
+    uint64_t hash = mix64(key, seed);
+    for (int i=0; i<3; i++) {
+      uint64_t js = slot(hash, i);
+      count[js]--;
+      xorKeys[js] ^= key;
+      if (count[js] == 1) queue.push_back(js);
+    }
+  }
+
+  if (order.size() != nkeys) return false;
+
+  // Assign in reverse, so each key's entry is free when it is reached
+  table.resize(3*segment, fpBits);
+  for (size_t k=order.size(); k-- > 0; ) {
+    uint64_t hash = mix64(order[k].first, seed);
+    uint64_t fp = fingerprint(hash);
+    for (int i=0; i<3; i++) fp ^= table.get(slot(hash, i));
+    table.set(order[k].second, fp);
+  }
+
+  return true;
+}
+
+bool XorFilter::contains(objectId_t key) const {
+  if (table.size() == 0) return failed;
+
+  uint64_t hash = mix64(key, seed);
+  return fingerprint(hash) == (table.get(slot(hash,0)) ^
+			       table.get(slot(hash,1)) ^
+			       table.get(slot(hash,2)));
+}
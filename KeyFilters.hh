@@ -0,0 +1,90 @@
+#ifndef KEY_FILTERS_HH
+#define KEY_FILTERS_HH 1
+// $Id$
+// KeyFilters.hh -- Approximate-membership filters over objectIds, which
+// may report false positives but never false negatives.
+//
+// 20261017  Michael Kelsey
+// 20261017  Build from generated keys, rather than a copy of key set
+// 20261017  Xor filter passes every key if construction fails
+
+#include "IndexTester.hh"
+#include "PackedArray.hh"
+#include <stdint.h>
+#include <functional>
+#include <vector>
+
+
+// Interface for all filter types
+
+class KeyFilter {
+public:
+  KeyFilter() {;}
+  virtual ~KeyFilter() {;}
+
+  virtual const char* name() const = 0;
+
+  // Returns k'th key of set, for k < nkeys; may be called more than once
+  typedef std::function<objectId_t(uint64_t)> KeySource;
+
+  // Build filter from scratch for complete key set
+  virtual void build(uint64_t nkeys, const KeySource& key) = 0;
+
+  virtual bool contains(objectId_t key) const = 0;
+  virtual size_t bytes() const = 0;
+};
+
+
+// Blocked Bloom filter:  all bits for a key are in one 512-bit block,
+// so each query touches a single cache line.  Keys may be added later.
+
+class BloomFilter : public KeyFilter {
+public:
+  BloomFilter(double fpRate=0.01) : fpr(fpRate), nBlocks(0ULL), nHashes(0) {;}
+  virtual ~BloomFilter() {;}
+
+  virtual const char* name() const { return "bloom"; }
+
+  void reserve(uint64_t nkeys);			// Discards contents
+  void insert(objectId_t key);
+
+  virtual void build(uint64_t nkeys, const KeySource& key);
+  virtual bool contains(objectId_t key) const;
+  virtual size_t bytes() const { return blocks.size()*sizeof(uint64_t); }
+
+private:
+  double fpr;
+  uint64_t nBlocks;
+  unsigned nHashes;
+  std::vector<uint64_t> blocks;			// Eight words per block
+};
+
+
+// Xor filter (Graf and Lemire, 2020):  fingerprint of key is the xor of
+// three table entries.  Static, rebuilt for any change to key set.
+
+class XorFilter : public KeyFilter {
+public:
+  XorFilter(double fpRate=0.01);
+  virtual ~XorFilter() {;}
+
+  virtual const char* name() const { return "xor"; }
+
+  virtual void build(uint64_t nkeys, const KeySource& key);
+  virtual bool contains(objectId_t key) const;
+  virtual size_t bytes() const { return table.bytes(); }
+
+protected:
+  bool tryBuild(uint64_t nkeys, const KeySource& key);
+  uint64_t slot(uint64_t hash, int i) const;	// In segment i of table
+  uint64_t fingerprint(uint64_t hash) const { return hash >> (64-fpBits); }
+
+private:
+  unsigned fpBits;
+  uint64_t seed;
+  bool failed;					// No table; pass all keys
+  uint64_t segment;				// Table is three segments
+  PackedArray table;
+};
+
+#endif	/* KEY_FILTERS_HH */
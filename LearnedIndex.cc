@@ -0,0 +1,178 @@
+// $Id$
+// LearnedIndex.cc -- Exercise performance of a two-stage learned index
+// (recursive model index) over sorted keys as lookup table.
+//
+// 20261017  Michael Kelsey
+
+#include "LearnedIndex.hh"
+#include "SearchKernels.hh"
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+
+// Running least-squares fit of y vs. x (Welford), avoiding large sums
+
+namespace {
+  struct LinearFit {
+    LinearFit() : n(0.), mx(0.), my(0.), cxx(0.), cxy(0.) {;}
+
+    void add(double x, double y) {
+      n += 1.;
+      double dx = x - mx;
+      mx += dx/n;
+      my += (y - my)/n;
+      cxx += dx*(x - mx);
+      cxy += dx*(y - my);
+    }
+
+    double slope() const { return (cxx>0. ? cxy/cxx : 0.); }
+    double intercept() const { return my - slope()*mx; }
+
+    double n, mx, my, cxx, cxy;
+  };
+}
+
+
+// Constructor and destructor
+
+LearnedIndex::LearnedIndex(int verbose)
+  : IndexTester("learned",verbose), segmentSize(4096), nKeys(0ULL),
+    keys(0), chunks(0), rootSlope(0.), rootIntercept(0.), nSegments(0ULL),
+    segments(0) {;}
+
+void LearnedIndex::cleanup() {
+  delete[] keys;
+  keys = 0;
+  delete[] chunks;
+  chunks = 0;
+  delete[] segments;
+  segments = 0;
+  nKeys = nSegments = 0;
+}
+
+
+// Populate sorted arrays with full range of keys, then train model
+
+void LearnedIndex::create(objectId_t asize) {
+  if (keys) cleanup();			// Avoid memory leaks
+  if (asize == 0) return;
+
+  nKeys = asize;
+  keys = new objectId_t[nKeys];
+  chunks = new chunkId_t[nKeys]();	// Fill with zeroes
+
+  for (objectId_t i=0; i<nKeys; i++) {
+    keys[i] = i*indexStep;
+  }
+
+  fitUsage.zero();
+  fitUsage.start();
+  fitModel();
+  fitUsage.end();
+
+  if (verboseLevel>1) {
+    std::cout << "LearnedIndex " << nSegments << " segments, "
+	      << modelBytes() << " bytes, max error " << maxError()
+	      << ", fit " << fitUsage << std::endl;
+  }
+}
+
+
+// Train root model over all keys, then one linear model per segment
+
+void LearnedIndex::fitModel() {
+  if (segmentSize == 0) segmentSize = 4096;	// Sanity check
+  nSegments = std::max(nKeys/segmentSize, 1ULL);
+
+  LinearFit root;
+  for (objectId_t i=0; i<nKeys; i++) {
+    root.add((double)keys[i], (double)i*nSegments/nKeys);
+  }
+
+  rootSlope = std::max(root.slope(), 0.);	// Keeps segments contiguous
+  rootIntercept = root.intercept();
+
+  // Keys are sorted, so each segment covers a contiguous range
+  std::vector<objectId_t> segStart(nSegments+1, 0ULL);
+  for (objectId_t i=0; i<nKeys; i++) {
+    segStart[chooseSegment(keys[i])+1]++;
+  }
+
+  for (objectId_t s=0; s<nSegments; s++) segStart[s+1] += segStart[s];
+
+  segments = new Segment[nSegments];
+  for (objectId_t s=0; s<nSegments; s++) {
+    Segment& seg = segments[s];
+
+    LinearFit fit;
+    for (objectId_t i=segStart[s]; i<segStart[s+1]; i++) {
+      fit.add((double)keys[i], (double)i);
+    }
+
+    seg.slope = fit.slope();		// Empty segment predicts its start
+    seg.intercept = (fit.n>0. ? fit.intercept() : (double)segStart[s]);
+    seg.errLo = seg.errHi = 0;
+
+    for (objectId_t i=segStart[s]; i<segStart[s+1]; i++) {
+      long long err = (long long)i - predict(seg, keys[i]);
+      if (err < seg.errLo) seg.errLo = (int32_t)err;
+      if (err > seg.errHi) seg.errHi = (int32_t)err;
+    }
+  }
+}
+
+
+// First stage of model, clamped to valid range
+
+objectId_t LearnedIndex::chooseSegment(objectId_t key) const {
+  double s = rootSlope*(double)key + rootIntercept;
+  if (s < 0.) return 0;
+  return std::min((objectId_t)s, nSegments-1);
+}
+
+
+// Return chunk only if index was registered
+
+chunkId_t LearnedIndex::value(objectId_t index) {
+  if (!segments) return 0xdeadbeef;	// Include sanity check
+
+  const Segment& seg = segments[chooseSegment(index)];
+  long long guess = predict(seg, index);
+
+  // Last-mile search is bounded by errors measured during training
+  long long lo = std::max(guess + seg.errLo, 0LL);
+  long long hi = std::min(guess + seg.errHi + 1, (long long)nKeys);
+  if (lo >= hi) return 0xdeadbeef;
+
+  objectId_t pos = lo + branchlessLowerBound(keys+lo, hi-lo, index);
+  return (pos < nKeys && keys[pos] == index) ? chunks[pos] : 0xdeadbeef;
+}
+
+
+// Model size and accuracy, for reporting
+
+size_t LearnedIndex::modelBytes() const {
+  return nSegments*sizeof(Segment) + sizeof(rootSlope) + sizeof(rootIntercept);
+}
+
+objectId_t LearnedIndex::maxError() const {
+  objectId_t maxErr = 0;
+  for (objectId_t s=0; s<nSegments; s++) {
+    maxErr = std::max(maxErr, (objectId_t)std::max(-segments[s].errLo,
+						    segments[s].errHi));
+  }
+  return maxErr;
+}
+
+
+// Append model training time, size and accuracy to CSV report
+
+void LearnedIndex::reportHeadings(std::ostream& csv) const {
+  csv << ", Fit CPU (s), Fit Clock (s), Model (bytes), Max error";
+}
+
+void LearnedIndex::reportColumns(std::ostream& csv) const {
+  csv << ", " << fitUsage.cpuTime() << ", " << fitUsage.elapsed()
+      << ", " << modelBytes() << ", " << maxError();
+}
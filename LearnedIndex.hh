@@ -0,0 +1,61 @@
+#ifndef LEARNED_INDEX_HH
+#define LEARNED_INDEX_HH 1
+// $Id$
+// LearnedIndex.hh -- Exercise performance of a two-stage learned index
+// (recursive model index) over sorted keys as lookup table.
+//
+// 20261017  Michael Kelsey
+
+#include "IndexTester.hh"
+#include <stdint.h>
+
+
+class LearnedIndex : public IndexTester {
+public:
+  LearnedIndex(int verbose=0);
+  virtual ~LearnedIndex() { cleanup(); }
+
+  // Average number of keys covered by each second-stage linear model
+  void setSegmentSize(objectId_t nkeys=4096) { segmentSize = nkeys; }
+
+  size_t modelBytes() const;
+  objectId_t maxError() const;		// Largest miss in either direction
+
+protected:
+  virtual void create(objectId_t asize);
+  virtual chunkId_t value(objectId_t index);
+  virtual void cleanup();
+
+  virtual void reportHeadings(std::ostream& csv) const;
+  virtual void reportColumns(std::ostream& csv) const;
+
+  void fitModel();
+
+  // Linear model with error bounds around predicted position
+  struct Segment {
+    double slope;
+    double intercept;
+    int32_t errLo;			// Minimum of (actual - predicted)
+    int32_t errHi;			// Maximum of (actual - predicted)
+  };
+
+  objectId_t chooseSegment(objectId_t key) const;
+  static long long predict(const Segment& seg, objectId_t key) {
+    return (long long)(seg.slope*(double)key + seg.intercept);
+  }
+
+private:
+  objectId_t segmentSize;
+  objectId_t nKeys;
+  objectId_t* keys;
+  chunkId_t* chunks;
+
+  double rootSlope;			// First stage maps keys to segments
+  double rootIntercept;
+  objectId_t nSegments;
+  Segment* segments;
+
+  UsageTimer fitUsage;			// Model training alone
+};
+
+#endif	/* LEARNED_INDEX_HH */
@@ -0,0 +1,399 @@
+// $Id$
+// LsmIndex.cc -- Exercise performance of log-structured merge tree as
+// lookup table:  sorted in-memory memtable, flushed to immutable sorted
+// block files (each with a Bloom filter), merged by leveled compaction
+// in a background thread.
+//
+// 20261017  Michael Kelsey
+// 20261017  Report all keys put, beside mixed-workload writes
+
+#include "LsmIndex.hh"
+#include <unistd.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+
+// Constructor
+
+LsmIndex::LsmIndex(int verbose)
+  : IndexTester("lsm",verbose), memtableLimit(1000000), level0Limit(4),
+    fanout(10), writeFraction(0.), writeCredit(0.), stopping(false),
+    busy(false), runSeq(0), nFlushes(0L), nCompactions(0L), keysPut(0ULL),
+    keysFlushed(0ULL), keysWritten(0ULL), nQueries(0L), nWrites(0L), nRunChecks(0L),
+    nFiltered(0L) {;}
+
+void LsmIndex::setWriteFraction(double frac) {
+  writeFraction = frac;
+  SetName(frac > 0. ? "lsm-mixed" : "lsm");
+}
+
+
+// Stop background work, and delete all runs from disk
+
+void LsmIndex::cleanup() {
+  stopThread();
+
+  current.reset();			// Runs are deleted with last version
+  memtable.clear();
+
+  runSeq = 0;
+  nFlushes = nCompactions = 0;
+  keysPut = keysFlushed = keysWritten = 0;
+  nQueries = nWrites = nRunChecks = nFiltered = 0;
+  writeCredit = 0.;
+}
+
+
+// Load full range of keys, with clustered chunks, through the memtable
+
+void LsmIndex::create(objectId_t asize) {
+  cleanup();				// Discard previous table
+  startThread();
+
+  chunkGen.reset();
+  for (objectId_t i=0; i<asize; i++) put(i*indexStep, chunkGen.next());
+
+  waitIdle();				// Load is complete when compacted
+
+  if (verboseLevel>1) {
+    VersionPtr v = snapshot();
+    std::cout << " " << nFlushes << " flushes, " << nCompactions
+	      << " compactions, " << v->level0.size() << " level-0 runs, "
+	      << v->levels.size() << " levels" << std::endl;
+  }
+}
+
+
+// Bulk update from file of "objectId chunkId" lines; compaction is left
+// running in background, to be overlapped with queries
+
+void LsmIndex::update(const char* datafile) {
+  if (!datafile) return;
+
+  std::ifstream bulkfile(datafile);
+  if (!bulkfile) {
+    std::cerr << "LsmIndex::update " << datafile << " not found" << std::endl;
+    return;
+  }
+
+  objectId_t objID;
+  chunkId_t chunk;
+  while (bulkfile >> objID >> chunk) put(objID, chunk);
+}
+
+
+// Insert or replace entry; full memtable is handed to background thread,
+// waiting if the previous one is still being written
+
+void LsmIndex::put(objectId_t key, chunkId_t chunk) {
+  if (!worker.joinable()) startThread();
+
+  memtable[key] = chunk;
+  keysPut++;
+
+  if (memtable.size() < memtableLimit) return;
+
+  std::unique_lock<std::mutex> guard(lock);
+  while (current->immutable || current->level0.size() >= 2*level0Limit) {
+    changed.wait(guard);		// Stall writes until caught up
+  }
+
+  freezeMemtable();
+}
+
+
+// Hand memtable to background thread for writing; lock must be held
+
+void LsmIndex::freezeMemtable() {
+  std::shared_ptr<Memtable> frozen(new Memtable);
+  frozen->swap(memtable);
+
+  std::shared_ptr<Version> next(new Version(*current));
+  next->immutable = frozen;
+  current = next;
+
+  work.notify_one();
+}
+
+
+// Flush memtable (even if not full), and wait for compaction to finish
+
+void LsmIndex::waitIdle() {
+  std::unique_lock<std::mutex> guard(lock);
+  if (!current) return;
+
+  while (current->immutable) changed.wait(guard);
+
+  if (!memtable.empty()) freezeMemtable();
+
+  while (busy || current->immutable || pickCompaction(*current) >= 0) {
+    changed.wait(guard);
+  }
+}
+
+
+// Check memtables, then runs from newest to oldest; filters avoid most
+// disk reads for runs which do not have the key
+
+chunkId_t LsmIndex::value(objectId_t index) {
+  nQueries++;
+
+  if (writeFraction > 0.) {		// Mixed workload: replace entry
+    writeCredit += writeFraction;
+    if (writeCredit >= 1.) {
+      writeCredit -= 1.;
+      nWrites++;
+      chunkId_t chunk = chunkGen.next();
+      put(index, chunk);
+      return chunk;
+    }
+  }
+
+  Memtable::const_iterator found = memtable.find(index);
+  if (found != memtable.end()) return found->second;
+
+  VersionPtr v = snapshot();
+  if (!v) return 0xdeadbeef;
+
+  if (v->immutable) {
+    found = v->immutable->find(index);
+    if (found != v->immutable->end()) return found->second;
+  }
+
+  for (size_t i=0; i<v->level0.size()+v->levels.size(); i++) {
+    Run* run = (i < v->level0.size() ? v->level0[i]
+		: v->levels[i-v->level0.size()]).get();
+    if (!run) continue;
+
+    if (!run->filter.contains(index)) {
+      nFiltered++;
+      continue;
+    }
+
+    nRunChecks++;
+    chunkId_t chunk = run->file.lookup(index);
+    if (chunk != 0xdeadbeef) return chunk;
+  }
+
+  return 0xdeadbeef;
+}
+
+
+// Current version of table, safe to use after lock is released
+
+LsmIndex::VersionPtr LsmIndex::snapshot() const {
+  std::lock_guard<std::mutex> guard(lock);
+  return current;
+}
+
+
+// Background thread is started with empty table
+
+void LsmIndex::startThread() {
+  if (worker.joinable()) return;
+
+  stopping = false;
+  busy = false;
+  current.reset(new Version);
+  worker = std::thread(&LsmIndex::background, this);
+}
+
+void LsmIndex::stopThread() {
+  if (!worker.joinable()) return;
+
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    stopping = true;
+  }
+  work.notify_one();
+  worker.join();
+}
+
+
+// Write out immutable memtable as soon as it appears, then do any
+// compactions needed; the lock is released during file I/O
+
+void LsmIndex::background() {
+  std::unique_lock<std::mutex> guard(lock);
+
+  while (!stopping) {
+    VersionPtr v = current;
+    if (v->immutable) {
+      busy = true;
+      guard.unlock();
+      RunPtr run = writeRun(*v->immutable);
+      guard.lock();
+
+      std::shared_ptr<Version> next(new Version(*current));
+      next->immutable.reset();
+      next->level0.insert(next->level0.begin(), run);
+      current = next;
+      nFlushes++;
+      keysFlushed += run->file.keys();
+      keysWritten += run->file.keys();
+
+      changed.notify_all();
+      continue;
+    }
+
+    int level = pickCompaction(*v);
+    if (level >= 0) {
+      busy = true;
+
+      // Inputs newest first; output replaces next level down
+      std::vector<RunPtr> inputs;
+      if (level == 0) inputs = v->level0;
+      else inputs.push_back(v->levels[level-1]);
+      if ((int)v->levels.size() > level && v->levels[level]) {
+	inputs.push_back(v->levels[level]);
+      }
+
+      guard.unlock();
+      RunPtr merged = mergeRuns(inputs);
+      guard.lock();
+
+      // Only this thread changes runs, so the inputs are still in place
+      std::shared_ptr<Version> next(new Version(*current));
+      if (level == 0) next->level0.clear();
+      else next->levels[level-1].reset();
+      if ((int)next->levels.size() <= level) next->levels.resize(level+1);
+      next->levels[level] = merged;
+      current = next;
+      nCompactions++;
+      keysWritten += merged->file.keys();
+
+      changed.notify_all();
+      continue;
+    }
+
+    busy = false;
+    changed.notify_all();
+    work.wait(guard);
+  }
+
+  busy = false;
+}
+
+
+// Level 0 is compacted by number of runs, others by size
+
+int LsmIndex::pickCompaction(const Version& v) const {
+  if (v.level0.size() >= level0Limit) return 0;
+
+  for (size_t i=0; i<v.levels.size(); i++) {
+    if (v.levels[i] && v.levels[i]->file.keys() > levelLimit(i+1)) return i+1;
+  }
+
+  return -1;
+}
+
+uint64_t LsmIndex::levelLimit(int level) const {
+  uint64_t limit = memtableLimit*level0Limit;
+  for (int i=1; i<level; i++) limit *= fanout;
+  return limit;
+}
+
+
+// Write memtable to new run, with Bloom filter
+
+LsmIndex::RunPtr LsmIndex::writeRun(const Memtable& mem) {
+  RunPtr run(new Run);
+  run->filter.reserve(mem.size());
+
+  run->file.create(newRunName());
+  for (Memtable::const_iterator it=mem.begin(); it!=mem.end(); ++it) {
+    run->file.append(it->first, it->second);
+    run->filter.insert(it->first);
+  }
+  run->file.finish();
+
+  return run;
+}
+
+
+// Merge sorted runs block by block; for duplicate keys, the newest run
+// (earliest in list) has the current chunk
+
+LsmIndex::RunPtr LsmIndex::mergeRuns(const std::vector<RunPtr>& inputs) {
+  struct Cursor {
+    const BlockFile* file;
+    uint64_t iblock;
+    uint32_t pos;
+    BlockFile::Block blk;
+
+    bool valid() const { return pos < blk.count; }
+    objectId_t key() const { return blk.key[pos]; }
+    void next() {
+      if (++pos < blk.count) return;
+      pos = 0;
+      blk.count = 0;
+      if (++iblock < file->blocks()) file->readBlock(iblock, blk);
+    }
+  };
+
+  uint64_t nkeys = 0;
+  std::vector<Cursor> cursors(inputs.size());
+  for (size_t i=0; i<inputs.size(); i++) {
+    Cursor& c = cursors[i];
+    c.file = &inputs[i]->file;
+    c.iblock = c.pos = 0;
+    c.blk.count = 0;
+    if (c.file->blocks() > 0) c.file->readBlock(0, c.blk);
+    nkeys += c.file->keys();
+  }
+
+  RunPtr run(new Run);
+  run->filter.reserve(nkeys);
+  run->file.create(newRunName());
+
+  while (true) {
+    int first = -1;			// Lowest key, newest run on ties
+    for (size_t i=0; i<cursors.size(); i++) {
+      if (cursors[i].valid() &&
+	  (first < 0 || cursors[i].key() < cursors[first].key())) first = i;
+    }
+    if (first < 0) break;
+
+    objectId_t key = cursors[first].key();
+    run->file.append(key, cursors[first].blk.chunk[cursors[first].pos]);
+    run->filter.insert(key);
+
+    for (size_t i=0; i<cursors.size(); i++) {
+      if (cursors[i].valid() && cursors[i].key() == key) cursors[i].next();
+    }
+  }
+
+  run->file.finish();
+  return run;
+}
+
+std::string LsmIndex::newRunName() {
+  std::ostringstream name;
+  name << "/tmp/index-lsm-" << getpid() << "-" << runSeq++ << ".run";
+  return name.str();
+}
+
+
+// Append structure, write amplification and read cost
+
+void LsmIndex::reportHeadings(std::ostream& csv) const {
+  csv << ", Level-0 runs, Levels, Flushes, Compactions, Write amp"
+      << ", Writes, Keys put, Runs read/query, Runs filtered/query";
+}
+
+void LsmIndex::reportColumns(std::ostream& csv) const {
+  std::unique_lock<std::mutex> guard(lock);	// Background may be running
+  size_t nL0 = current ? current->level0.size() : 0;
+  size_t nLevels = current ? current->levels.size() : 0;
+  long flushes = nFlushes, compactions = nCompactions;
+  uint64_t flushed = keysFlushed, written = keysWritten, puts = keysPut;
+  guard.unlock();
+
+  csv << ", " << nL0 << ", " << nLevels << ", " << flushes
+      << ", " << compactions
+      << ", " << (flushed>0 ? (double)written/flushed : 0.)
+      << ", " << nWrites << ", " << puts
+      << ", " << (nQueries>0 ? (double)nRunChecks/nQueries : 0.)
+      << ", " << (nQueries>0 ? (double)nFiltered/nQueries : 0.);
+}
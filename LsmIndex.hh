@@ -0,0 +1,115 @@
+#ifndef LSM_INDEX_HH
+#define LSM_INDEX_HH 1
+// $Id$
+// LsmIndex.hh -- Exercise performance of log-structured merge tree as
+// lookup table:  sorted in-memory memtable, flushed to immutable sorted
+// block files (each with a Bloom filter), merged by leveled compaction
+// in a background thread.
+//
+// 20261017  Michael Kelsey
+
+#include "IndexTester.hh"
+#include "BlockFile.hh"
+#include "ChunkGenerator.hh"
+#include "KeyFilters.hh"
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+class LsmIndex : public IndexTester {
+public:
+  LsmIndex(int verbose=0);
+  virtual ~LsmIndex() { cleanup(); }
+
+  // Configuration; must be set before table is created
+  void setMemtableSize(size_t n=1000000) { memtableLimit = n; }
+  void setLevel0Limit(size_t n=4) { level0Limit = n; }
+  void setFanout(unsigned n=10) { fanout = n; }
+
+  // Fraction of exercised queries which instead write a new chunk
+  void setWriteFraction(double frac);
+
+  void put(objectId_t key, chunkId_t chunk);
+  void waitIdle();			// Flush memtable, finish compaction
+
+protected:
+  virtual void create(objectId_t asize);
+  virtual void update(const char* datafile);
+  virtual chunkId_t value(objectId_t index);
+  virtual void cleanup();
+
+  virtual void reportHeadings(std::ostream& csv) const;
+  virtual void reportColumns(std::ostream& csv) const;
+
+  typedef std::map<objectId_t, chunkId_t> Memtable;
+
+  // Immutable sorted run on disk, deleted when no version refers to it
+  struct Run {
+    BlockFile file;
+    BloomFilter filter;
+    ~Run() { file.remove(); }
+  };
+
+  typedef std::shared_ptr<Run> RunPtr;
+
+  // Snapshot of table structure, replaced (never modified) by updates
+  struct Version {
+    std::shared_ptr<const Memtable> immutable;	// Being flushed
+    std::vector<RunPtr> level0;			// Overlapping, newest first
+    std::vector<RunPtr> levels;			// Level 1 and up, one run each
+  };
+
+  typedef std::shared_ptr<const Version> VersionPtr;
+
+  VersionPtr snapshot() const;
+  void freezeMemtable();			// Lock must be held
+
+  void startThread();
+  void stopThread();
+  void background();			// Flush and compaction loop
+
+  int pickCompaction(const Version& v) const;	// Level, or -1 if none
+  uint64_t levelLimit(int level) const;		// Maximum keys in level
+
+  RunPtr writeRun(const Memtable& mem);
+  RunPtr mergeRuns(const std::vector<RunPtr>& inputs);	// Newest first
+  std::string newRunName();
+
+private:
+  size_t memtableLimit;
+  size_t level0Limit;
+  unsigned fanout;
+  double writeFraction;
+  double writeCredit;
+
+  Memtable memtable;			// Only used by main thread
+  VersionPtr current;
+
+  mutable std::mutex lock;		// Protects following members
+  std::condition_variable work;		// Signals background thread
+  std::condition_variable changed;	// Signals new version or idle
+  bool stopping;
+  bool busy;
+  std::thread worker;
+
+  unsigned runSeq;
+  long nFlushes;
+  long nCompactions;
+  uint64_t keysPut;			// Including create and update
+  uint64_t keysFlushed;			// From memtables to disk
+  uint64_t keysWritten;			// Including compaction
+
+  long nQueries;
+  long nWrites;
+  long nRunChecks;			// Runs consulted by lookups
+  long nFiltered;			// Runs skipped by Bloom filter
+
+  ChunkGenerator chunkGen;
+};
+
+#endif	/* LSM_INDEX_HH */
@@ -6,23 +6,36 @@
 // 20151118  Add diagnostic messages for all memcached actions
 // 20160217  Support sparse indexing into map
 // 20160224  Move destructor action to cleanup() function
+// 20261017  Batched lookups with multi-get, reusing one result object
+// 20261017  Bulk loading with buffered, no-reply sets from several threads
 
 #include "MemCDIndex.hh"
 #include <libmemcached/memcached.h>
 #include <signal.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/wait.h>
 #include <unistd.h>
+#include <algorithm>
+#include <chrono>
 #include <sstream>
 #include <iostream>
+#include <thread>
 using namespace std;
 
 // Constructor and destructor
 
 MemCDIndex::MemCDIndex(int verbose)
-  : IndexTester("memcached",verbose), mcdsv(0), memcd(0) {;}
+  : IndexTester("memcached",verbose), mcdsv(0), memcd(0), result(0),
+    loadThreads(0), loadRate(0.), nGets(0), nKeys(0) {;}
+
+void MemCDIndex::setBulkLoad(int threads) {
+  loadThreads = (threads > 0) ? threads : 0;
+  SetName(loadThreads>0 ? "memcached-bulk" : "memcached");
+}
 
 void MemCDIndex::cleanup() {
   if (mcdsv) killServer();
@@ -74,9 +87,9 @@ bool MemCDIndex::launchClient(objectId_t asize) {
 
   stringstream mcdstr;
   mcdstr << "--SERVER=localhost --BINARY-PROTOCOL --POOL-MAX=" << asize;
-  const char* mcdconf = mcdstr.str().c_str();
+  config = mcdstr.str();		// Must outlive the client
 
-  memcd = memcached(mcdconf, strlen(mcdconf));
+  memcd = memcached(config.c_str(), config.size());
   if (!memcd) {
     cerr << "Client creation failed!" << endl;
     return false;
@@ -85,9 +98,11 @@ bool MemCDIndex::launchClient(objectId_t asize) {
   // Set non-blocking I/O for maximum performance
   memcached_behavior_set(memcd, MEMCACHED_BEHAVIOR_NO_BLOCK, 1);
 
+  result = memcached_result_create(memcd, 0);
+
   if (verboseLevel) {
     memcached_return_t mcdret =
-      libmemcached_check_configuration(mcdconf, strlen(mcdconf), 0, 0);
+      libmemcached_check_configuration(config.c_str(), config.size(), 0, 0);
     cerr << memcached_strerror(memcd, mcdret) << endl;
   }
 
@@ -101,8 +116,22 @@ void MemCDIndex::create(objectId_t asize) {
   launchServer(asize); if (!mcdsv) return;
   launchClient(asize); if (!memcd) return;
 
+  nGets = nKeys = 0;
+
   if (verboseLevel>1) cout << "Filling " << asize << " keys" << endl;
 
+  std::chrono::steady_clock::time_point start =
+    std::chrono::steady_clock::now();
+
+  if (loadThreads > 0) bulkLoad(asize);
+  else fillTable(asize);
+
+  std::chrono::duration<double> elapsed =
+    std::chrono::steady_clock::now() - start;
+  loadRate = (elapsed.count() > 0.) ? asize / elapsed.count() : 0.;
+}
+
+void MemCDIndex::fillTable(objectId_t asize) {
   const chunkId_t zero=0;		// All keys have same dummy value
   memcached_return_t error;
   for (objectId_t key=0; key<asize*indexStep; key+=indexStep) {
@@ -116,30 +145,148 @@ void MemCDIndex::create(objectId_t asize) {
 }
 
 
-// Query server to get requested index entry
+// Each thread stores a contiguous range of keys, with its own client
 
-chunkId_t MemCDIndex::value(objectId_t index) {
-  if (!memcd) return 0xdeadbeef;	// Include sanity check
+void MemCDIndex::bulkLoad(objectId_t asize) {
+  int nThreads = (asize < (objectId_t)loadThreads) ? 1 : loadThreads;
+  objectId_t perThread = (asize + nThreads-1) / nThreads;
+
+  std::vector<std::thread> loaders;
+  std::vector<long> nFailed(nThreads, 0);
+  for (int i=0; i<nThreads; i++) {
+    objectId_t first = i*perThread;
+    objectId_t last = std::min(first+perThread, asize);
+    loaders.push_back(std::thread(&MemCDIndex::loadRange, this, first, last,
+				  std::ref(nFailed[i])));
+  }
+
+  long failures = 0;
+  for (int i=0; i<nThreads; i++) {
+    loaders[i].join();
+    failures += nFailed[i];
+  }
+
+  if (failures > 0) cerr << "Failed to store " << failures << " keys" << endl;
+
+  if (verboseLevel>1)
+    cout << "Loaded " << asize << " keys from " << nThreads << " threads"
+	 << endl;
+}
+
+// Sets are buffered and not acknowledged, so only local errors are seen;
+// a final get on the same connection waits for the server to catch up
+
+void MemCDIndex::loadRange(objectId_t first, objectId_t last,
+			   long& nFailed) {
+  if (first >= last) return;
+
+  memcached_st* loader = memcached_clone(0, memcd);
+  if (!loader) {
+    nFailed += last-first;
+    return;
+  }
+
+  memcached_behavior_set(loader, MEMCACHED_BEHAVIOR_BUFFER_REQUESTS, 1);
+  memcached_behavior_set(loader, MEMCACHED_BEHAVIOR_NOREPLY, 1);
+
+  const chunkId_t zero=0;		// All keys have same dummy value
+  memcached_return_t error;
+  for (objectId_t key=first*indexStep; key<last*indexStep; key+=indexStep) {
+    error = memcached_set(loader, (const char*)&key, sizeof(key),
+			  (const char*)&zero, sizeof(int), 0, 0);
+    if (error != MEMCACHED_SUCCESS && error != MEMCACHED_BUFFERED) nFailed++;
+  }
+
+  memcached_flush_buffers(loader);
 
-  if (verboseLevel>1) cout << "Looking for " << index;
+  memcached_behavior_set(loader, MEMCACHED_BEHAVIOR_NOREPLY, 0);
+  memcached_behavior_set(loader, MEMCACHED_BEHAVIOR_BUFFER_REQUESTS, 0);
 
+  objectId_t key = (last-1)*indexStep;
   size_t blen;
   uint32_t flags;
-  memcached_return_t error;
-  char* buf = memcached_get(memcd, (const char*)&index, sizeof(index),
+  char* buf = memcached_get(loader, (const char*)&key, sizeof(key),
 			    &blen, &flags, &error);
+  if (!buf) {
+    cerr << "Bulk load lost key " << key << ": "
+	 << memcached_strerror(loader,error) << endl;
+  }
+
+  free(buf);
+  memcached_free(loader);
+}
+
+
+// Query server to get requested index entry, as a batch of one
+
+chunkId_t MemCDIndex::value(objectId_t index) {
+  chunkId_t chunk;
+  values(&index, &chunk, 1);
+  return chunk;
+}
+
+// Send all keys in one multi-get; results come back in any order, and
+// only for keys which were found, so each is matched to its positions
+
+void MemCDIndex::values(const objectId_t* index, chunkId_t* chunk, size_t n) {
+  std::fill(chunk, chunk+n, 0xdeadbeef);
+  if (!memcd || !result || n==0) return;	// Include sanity check
+
+  if (verboseLevel>1) cout << "Looking for " << n << " keys" << endl;
+
+  keys.resize(n);
+  keyLengths.assign(n, sizeof(objectId_t));
+  positions.resize(n);
+  for (size_t i=0; i<n; i++) {
+    keys[i] = (const char*)(index+i);
+    positions[i] = std::make_pair(index[i], i);
+  }
+  std::sort(positions.begin(), positions.end());
+
+  memcached_return_t error = memcached_mget(memcd, &keys[0], &keyLengths[0],
+					    n);
+  if (error != MEMCACHED_SUCCESS) {
+    if (verboseLevel>1)
+      cerr << "memcached error " << memcached_strerror(memcd,error) << endl;
+    return;
+  }
+
+  nGets++;
+  nKeys += n;
+
+  while (memcached_fetch_result(memcd, result, &error)) {
+    objectId_t key;
+    chunkId_t valbuf;		// To copy "byte array" into numeric value
+    if (memcached_result_key_length(result) != sizeof(key) ||
+	memcached_result_length(result) != sizeof(valbuf)) continue;
 
-  if (verboseLevel>1 && error != MEMCACHED_SUCCESS)
+    memcpy(&key, memcached_result_key_value(result), sizeof(key));
+    memcpy(&valbuf, memcached_result_value(result), sizeof(valbuf));
+
+    std::vector<std::pair<objectId_t,size_t> >::iterator pos =
+      std::lower_bound(positions.begin(), positions.end(),
+		       std::make_pair(key, (size_t)0));
+    for (; pos != positions.end() && pos->first == key; ++pos) {
+      chunk[pos->second] = valbuf;	// Key may be repeated in batch
+    }
+  }
+
+  if (verboseLevel>1 && error != MEMCACHED_END && error != MEMCACHED_SUCCESS)
     cerr << "memcached error " << memcached_strerror(memcd,error) << endl;
-			   
-  if (!buf) return 0xdeadbeef;
+}
+
 
-  chunkId_t valbuf;		// To copy "byte array" into numeric value
-  memcpy(&valbuf, buf, blen);
-  delete buf;			// Avoid memory leaks
+// Append multi-get statistics
 
-  if (verboseLevel>1) cout << " got value " << valbuf << endl;
-  return valbuf;
+void MemCDIndex::reportHeadings(std::ostream& csv) const {
+  csv << ", Load threads, Load rate (keys/s), Batch size, Multi-gets"
+      << ", Keys/get";
+}
+
+void MemCDIndex::reportColumns(std::ostream& csv) const {
+  csv << ", " << (loadThreads>0 ? loadThreads : 1) << ", " << loadRate
+      << ", " << batchSize << ", " << nGets << ", "
+      << (nGets>0 ? (double)nKeys/nGets : 0.);
 }
 
 
@@ -158,6 +305,9 @@ void MemCDIndex::killServer() {
 void MemCDIndex::killClient() {
   if (!memcd) return;		// Avoid unnecessary work
 
+  if (result) memcached_result_free(result);
+  result = 0;
+
   memcached_free(memcd);
   memcd = 0;
 }
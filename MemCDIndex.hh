@@ -5,11 +5,17 @@
 //
 // 20151023  Michael Kelsey
 // 20160224  Move destructor action to cleanup() function
+// 20261017  Batched lookups with multi-get, reusing one result object
+// 20261017  Bulk loading with buffered, no-reply sets from several threads
 
 #include "IndexTester.hh"
 #include <sys/types.h>
+#include <string>
+#include <utility>
+#include <vector>
 
 class memcached_st;
+struct memcached_result_st;
 
 
 class MemCDIndex : public IndexTester {
@@ -17,20 +23,45 @@ public:
   MemCDIndex(int verbose=0);
   virtual ~MemCDIndex() { cleanup(); }
 
+  // Fill table from several threads, each with its own client, sending
+  // buffered sets with no replies; zero threads uses one blocking client
+  void setBulkLoad(int threads=4);			// Changes CSV name
+
 protected:
   virtual void create(objectId_t asize);
   virtual chunkId_t value(objectId_t index);
+  virtual void values(const objectId_t* index, chunkId_t* chunk, size_t n);
   virtual void cleanup();
 
+  virtual void reportHeadings(std::ostream& csv) const;
+  virtual void reportColumns(std::ostream& csv) const;
+
   bool launchServer(objectId_t asize);
   bool launchClient(objectId_t asize);
 
   void killServer();
   void killClient();
 
+  void fillTable(objectId_t asize);	// One blocking set per key
+  void bulkLoad(objectId_t asize);
+  void loadRange(objectId_t first, objectId_t last, long& nFailed);
+
 private:
   pid_t mcdsv;			// Process ID of server, for killing
   memcached_st* memcd;		// State of memcached client
+  memcached_result_st* result;	// Reused for every fetched value
+  std::string config;		// Client configuration, for memcached()
+
+  int loadThreads;
+  double loadRate;		// Keys stored per second
+
+  // Buffers for multi-get, reused for every batch
+  std::vector<const char*> keys;
+  std::vector<size_t> keyLengths;
+  std::vector<std::pair<objectId_t,size_t> > positions;	// Sorted by key
+
+  long nGets;			// Multi-get requests to server
+  long nKeys;
 };
 
 #endif	/* MEMCD_INDEX_HH */
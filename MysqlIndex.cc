@@ -5,31 +5,127 @@
 // 20160204  Extend to support blocking data into smaller tables
 // 20160216  Add support for doing "bulk updates" from flat files
 // 20160218  Use update() loading for initial table setup
+// 20261017  Add lookups with prepared statements (binary protocol)
+// 20261017  Add batched lookups, with IN-list or temporary table join
+// 20261017  Add parallel loading of block tables, one connection per thread
+// 20261017  Share connection setup between main and loader connections
 
 #include "MysqlIndex.hh"
 #include <algorithm>
 #include <cmath>
+#include <stdio.h>
 #include <fstream>
 #include <iostream>
 #include <mysql/mysql.h>
 #include <sstream>
 #include <string>
+#include <string.h>
+#include <thread>
 #include <unistd.h>
 #include <vector>
 using namespace std;
 
 
+// Rows for a table are generated as the server asks for them, in place
+// of a temporary load file (LOAD DATA LOCAL with an infile handler)
+
+namespace {
+  struct RowSource {
+    objectId_t next;			// Next objectID to generate
+    objectId_t remaining;
+    unsigned step;
+    string pending;			// Formatted rows not yet delivered
+    size_t used;
+  };
+
+  int rowsInit(void** ptr, const char* /*filename*/, void* userdata) {
+    *ptr = userdata;
+    return 0;
+  }
+
+  int rowsRead(void* ptr, char* buf, unsigned int buflen) {
+    RowSource* src = (RowSource*)ptr;
+
+    unsigned int copied = 0;
+    while (copied < buflen) {
+      if (src->used == src->pending.size()) {	// Format more rows
+	if (src->remaining == 0) break;
+
+	src->pending.clear();
+	src->used = 0;
+	char line[32];
+	for (int i=0; i<1024 && src->remaining>0; i++) {
+	  src->pending.append(line, snprintf(line, sizeof(line), "%llu\t5\n",
+					     src->next));
+	  src->next += src->step;
+	  src->remaining--;
+	}
+      }
+
+      size_t n = std::min((size_t)(buflen-copied),
+			  src->pending.size()-src->used);
+      memcpy(buf+copied, src->pending.data()+src->used, n);
+      copied += n;
+      src->used += n;
+    }
+
+    return copied;				// Zero for end of data
+  }
+
+  void rowsEnd(void* /*ptr*/) {;}
+
+  int rowsError(void* /*ptr*/, char* msg, unsigned int msglen) {
+    snprintf(msg, msglen, "Row generator failed");
+    return 1;
+  }
+}
+
+
 // Constructor and destructor
 
 MysqlIndex::MysqlIndex(int verbose)
   : IndexTester("mysql",verbose), mysqlDB(0), dbname("SecIdx"),
-    table("chunks"), blockSize(0ULL) {;}
+    table("chunks"), blockSize(0ULL), prepared(false), lookupID(0ULL),
+    lookupChunk(0U), loadThreads(0), localLoad(true), fullName("mysql"),
+    joinThreshold(10000), haveJoinTable(false),
+    nQueries(0), nQueryIDs(0), nJoins(0) {
+  // Statements copy these when bound; buffers are reused for every query
+  memset(&lookupParam, 0, sizeof(lookupParam));
+  lookupParam.buffer_type = MYSQL_TYPE_LONGLONG;
+  lookupParam.buffer = &lookupID;
+  lookupParam.is_unsigned = 1;
+
+  memset(&lookupResult, 0, sizeof(lookupResult));
+  lookupResult.buffer_type = MYSQL_TYPE_LONG;
+  lookupResult.buffer = &lookupChunk;
+  lookupResult.is_unsigned = 1;
+}
+
+void MysqlIndex::setPrepared(bool prep) {
+  prepared = prep;
+  updateName();
+}
+
+void MysqlIndex::setParallelLoad(int threads, bool local) {
+  loadThreads = (threads > 0) ? threads : 0;
+  localLoad = local;
+  updateName();
+}
+
+void MysqlIndex::updateName() {
+  fullName = "mysql";
+  if (prepared) fullName += "-prepared";
+  if (loadThreads > 0) fullName += "-parallel";
+  SetName(fullName.c_str());
+}
 
 void MysqlIndex::cleanup() {
   if (!mysqlDB) return;				// Avoid unnecessary work
 
   if (verboseLevel) cout << "MysqlIndex::cleanup" << endl;
 
+  closeStatements();		// Must be done before tables are dropped
+
   // FIXME:  Why did this go into an infinite loop when empty()?
   blockStart.clear();		// Discard index ranges for block tables
 
@@ -46,25 +142,28 @@ void MysqlIndex::cleanup() {
 
   mysql_close(mysqlDB);
   mysqlDB = 0;
+  haveJoinTable = false;
 }
 
 
 // Transmit query string to MySQL server, report error if any
 
-void MysqlIndex::sendQuery(const string& query) const {
+void MysqlIndex::sendQuery(const string& query, MYSQL* db) const {
   if (verboseLevel>1) cout << "sending: " << query << endl;
 
-  mysql_query(mysqlDB, query.c_str());
-  reportError();
+  if (!db) db = mysqlDB;
+  mysql_query(db, query.c_str());
+  reportError(db);
 }
 
 
 // Print MySQL error message if any in present
 
-void MysqlIndex::reportError() const {
-  if (mysql_error(mysqlDB)[0] == '\0') return;	// No current error message
+void MysqlIndex::reportError(MYSQL* db) const {
+  if (!db) db = mysqlDB;
+  if (mysql_error(db)[0] == '\0') return;	// No current error message
 
-  cerr << mysql_error(mysqlDB) << endl;
+  cerr << mysql_error(db) << endl;
 }
 
 
@@ -92,7 +191,7 @@ int MysqlIndex::chooseTable(objectId_t objID) const {
     lower_bound(blockStart.begin(), blockStart.end(), objID);
 
   int tblidx = lb - blockStart.begin();
-  if (objID < *lb) tblidx--;			// Lower bound returns ceiling
+  if (lb == blockStart.end() || objID < *lb) tblidx--;	// Returns ceiling
 
   return tblidx;
 }
@@ -117,13 +216,18 @@ void MysqlIndex::create(objectId_t asize) {
   if (!connect(dbname) || !mysqlDB) return;	// Avoid unnecessary work
 
   tableSize = asize;		// Store for use in filling and querying
+  nQueries = nQueryIDs = nJoins = 0;
 
   accessDatabase();
   createTables();
   fillTableRanges();
+
+  if (prepared) prepareStatements();
 }
 
 chunkId_t MysqlIndex::value(objectId_t objID) {
+  if (prepared) return findPrepared(objID);
+
   MYSQL_RES* result = findObjectID(objID);	// NULL handled automatically
   chunkId_t chunk = extractChunk(result);
   mysql_free_result(result);			// Clean up before exiting
@@ -145,17 +249,28 @@ bool MysqlIndex::connect(const string& newDBname) {
   if (!newDBname.empty()) dbname = newDBname;	// Replace database name in use
 
   // connect to mysql server, no particular database
-  mysqlDB = mysql_init(NULL);
+  mysqlDB = openConnection("");
+  return (mysqlDB != 0);
+}
+
+// All connections (main and loader threads) use the same server and login;
+// null is returned on failure
+
+MYSQL* MysqlIndex::openConnection(const string& db, bool localInfile) const {
+  MYSQL* conn = mysql_init(NULL);
+  if (!conn) return 0;
 
-  if (!mysql_real_connect(mysqlDB, "127.0.0.1", "root", "changeme",
-			  "", 13306, NULL, 0)) {
-    cerr << mysql_error(mysqlDB) << endl;
-    mysql_close(mysqlDB);
-    mysqlDB = 0;
-    return false;
+  unsigned int enable = 1;
+  if (localInfile) mysql_options(conn, MYSQL_OPT_LOCAL_INFILE, &enable);
+
+  if (!mysql_real_connect(conn, "127.0.0.1", "root", "changeme",
+			  db.c_str(), 13306, NULL, 0)) {
+    cerr << mysql_error(conn) << endl;
+    mysql_close(conn);
+    return 0;
   }
 
-  return true;
+  return conn;
 }
 
 void MysqlIndex::accessDatabase() const {
@@ -175,7 +290,13 @@ void MysqlIndex::createTables() const {
 	      << endl;
   }
 
-  if (usingMultipleTables()) {			// One table for each block
+  if (loadThreads > 0) {			// Create all, then fill together
+    int nTables = numberOfTables();
+    for (int itbl=0; itbl<nTables; itbl++) {
+      createTable(usingMultipleTables() ? itbl : -1);
+    }
+    loadTables();
+  } else if (usingMultipleTables()) {		// One table for each block
     int nTables = numberOfTables();
     if (verboseLevel>1) {
       cout << " creating " << nTables << " tables with "
@@ -206,7 +327,7 @@ void MysqlIndex::createTable(int tblidx) const {
 }
 
 void MysqlIndex::fillTable(int tblidx, objectId_t tsize,
-			   objectId_t firstID) const {
+			   objectId_t firstID, MYSQL* db) const {
   if (!mysqlDB) return;				// Avoid unnecessary work
 
   if (verboseLevel) {
@@ -218,11 +339,76 @@ void MysqlIndex::fillTable(int tblidx, objectId_t tsize,
   string loadfile = makeTableName(tblidx)+".dat";
 
   createLoadFile(loadfile.c_str(), tsize, firstID, indexStep);
-  updateTable(loadfile.c_str(), tblidx);
+  updateTable(loadfile.c_str(), tblidx, db);
   unlink(loadfile.c_str());		// Delete input file when done
 }
 
 
+// Fill all tables using a pool of connections, one per thread
+
+void MysqlIndex::loadTables() const {
+  if (!mysqlDB) return;				// Avoid unnecessary work
+
+  int nThreads = std::min(loadThreads, numberOfTables());
+  if (verboseLevel) {
+    cout << "MysqlIndex::loadTables " << numberOfTables() << " tables with "
+	 << nThreads << " threads" << (localLoad ? " (local)" : "") << endl;
+  }
+
+  // Server refuses LOAD DATA LOCAL unless enabled (default in MySQL 8)
+  if (localLoad) sendQuery("SET GLOBAL local_infile=1");
+
+  std::atomic<int> nextTable(0);
+  vector<std::thread> loaders;
+  for (int i=0; i<nThreads; i++) {
+    loaders.push_back(std::thread(&MysqlIndex::loadThread, this, &nextTable));
+  }
+
+  for (int i=0; i<nThreads; i++) loaders[i].join();
+}
+
+void MysqlIndex::loadThread(std::atomic<int>* nextTable) const {
+  mysql_thread_init();
+
+  MYSQL* db = openConnection(dbname, localLoad);
+  if (db) {
+    // Primary key is still enforced; these skip other checks during load
+    sendQuery("SET SESSION unique_checks=0", db);
+    sendQuery("SET SESSION foreign_key_checks=0", db);
+
+    int nTables = numberOfTables();
+    for (int itbl=(*nextTable)++; itbl<nTables; itbl=(*nextTable)++) {
+      objectId_t tsize = blockSize;		// Last table may be short
+      if (itbl == nTables-1) tsize = tableSize - (nTables-1)*blockSize;
+      objectId_t firstID = itbl*blockSize*indexStep;
+
+      int tblidx = usingMultipleTables() ? itbl : -1;
+      if (localLoad) streamTable(db, tblidx, tsize, firstID);
+      else fillTable(tblidx, tsize, firstID, db);
+    }
+
+    mysql_close(db);
+  }
+
+  mysql_thread_end();
+}
+
+void MysqlIndex::streamTable(MYSQL* db, int tblidx, objectId_t tsize,
+			     objectId_t firstID) const {
+  if (verboseLevel>1) {
+    cout << "MysqlIndex::streamTable " << tblidx << " " << tsize
+	 << " " << firstID << endl;
+  }
+
+  RowSource rows = { firstID, tsize, indexStep, string(), 0 };
+  mysql_set_local_infile_handler(db, rowsInit, rowsRead, rowsEnd, rowsError,
+				 &rows);
+
+  sendQuery("LOAD DATA LOCAL INFILE 'generated' REPLACE INTO TABLE "
+	    + makeTableName(tblidx) + " FIELDS TERMINATED BY '\\t'", db);
+}
+
+
 // Set up local cache of object ID ranges in each table block
 
 void MysqlIndex::fillTableRanges() {
@@ -350,7 +536,8 @@ void MysqlIndex::update(const char* datafile) {
 
 // Insert contents of external file into specified table block
 
-void MysqlIndex::updateTable(const char* datafile, int tblidx) const {
+void MysqlIndex::updateTable(const char* datafile, int tblidx,
+			     MYSQL* db) const {
   if (!datafile) return;		// No external file specified
 
   if (verboseLevel) {
@@ -367,7 +554,7 @@ void MysqlIndex::updateTable(const char* datafile, int tblidx) const {
   stringstream loadIt;
   loadIt << "LOAD DATA INFILE '" << realdata << "' REPLACE INTO TABLE "
 	 << makeTableName(tblidx) << " FIELDS TERMINATED BY '\\t'";
-  sendQuery(loadIt.str());
+  sendQuery(loadIt.str(), db);
 
   delete realdata;				// Clean up output of realpath()
 }
@@ -386,6 +573,196 @@ MYSQL_RES* MysqlIndex::findObjectID(objectId_t objID) const {
   return getQueryResult();
 }
 
+// Prepare lookup statement for each table; parameter and result buffers
+// are bound once, so queries need no string formatting or allocation
+
+void MysqlIndex::prepareStatements() {
+  closeStatements();
+
+  if (!mysqlDB) return;				// Avoid unnecessary work
+
+  if (verboseLevel) cout << "MysqlIndex::prepareStatements" << endl;
+
+  int nTables = numberOfTables();
+  for (int itbl=0; itbl<nTables; itbl++) {
+    string query = "SELECT chunkId FROM "
+      + makeTableName(usingMultipleTables() ? itbl : -1)
+      + " WHERE objectId=?";
+
+    if (verboseLevel>1) cout << "preparing: " << query << endl;
+
+    MYSQL_STMT* stmt = mysql_stmt_init(mysqlDB);
+    if (!stmt || mysql_stmt_prepare(stmt, query.c_str(), query.size()) ||
+	mysql_stmt_bind_param(stmt, &lookupParam) ||
+	mysql_stmt_bind_result(stmt, &lookupResult)) {
+      if (stmt) {
+	cerr << mysql_stmt_error(stmt) << endl;
+	mysql_stmt_close(stmt);
+      } else {
+	reportError();
+      }
+      closeStatements();
+      return;
+    }
+
+    lookupStmt.push_back(stmt);
+  }
+}
+
+void MysqlIndex::closeStatements() {
+  for (size_t i=0; i<lookupStmt.size(); i++) mysql_stmt_close(lookupStmt[i]);
+  lookupStmt.clear();
+}
+
+chunkId_t MysqlIndex::findPrepared(objectId_t objID) {
+  size_t tblidx = std::max(chooseTable(objID), 0);
+  if (tblidx >= lookupStmt.size()) return 0xdeadbeef;
+
+  MYSQL_STMT* stmt = lookupStmt[tblidx];
+  lookupID = objID;
+  if (mysql_stmt_execute(stmt)) {
+    cerr << mysql_stmt_error(stmt) << endl;
+    return 0xdeadbeef;
+  }
+
+  // Primary key gives at most one row; fetch to end to finish the query
+  chunkId_t chunk = 0xdeadbeef;
+  int status;
+  while ((status = mysql_stmt_fetch(stmt)) == 0) chunk = lookupChunk;
+  if (status != MYSQL_NO_DATA) cerr << mysql_stmt_error(stmt) << endl;
+
+  if (verboseLevel>1) cout << "result: " << chunk << endl;
+
+  return chunk;
+}
+
+// Batch is sorted by objectID, so that the IDs for each table are together;
+// each table gets one query, with results streamed back
+
+void MysqlIndex::values(const objectId_t* index, chunkId_t* chunk,
+			size_t n) {
+  std::fill(chunk, chunk+n, 0xdeadbeef);
+  if (!mysqlDB) return;				// Avoid unnecessary work
+
+  order.resize(n);
+  for (size_t i=0; i<n; i++) order[i] = i;
+  std::sort(order.begin(), order.end(),
+	    [index](size_t a, size_t b) { return index[a] < index[b]; });
+
+  size_t first = 0;
+  while (first < n) {
+    int tblidx = chooseTable(index[order[first]]);
+    size_t last = first+1;
+    while (last < n && chooseTable(index[order[last]]) == tblidx) last++;
+
+    if (tblidx >= 0 || !usingMultipleTables()) {  // Else below first block
+      if (last-first >= joinThreshold)
+	findByJoin(tblidx, index, chunk, first, last);
+      else
+	findByList(tblidx, index, chunk, first, last);
+    }
+
+    first = last;
+  }
+}
+
+namespace {
+  void appendID(string& query, objectId_t objID) {
+    char buf[24];
+    query.append(buf, snprintf(buf, sizeof(buf), "%llu", objID));
+  }
+}
+
+void MysqlIndex::findByList(int tblidx, const objectId_t* index,
+			    chunkId_t* chunk, size_t first, size_t last) {
+  query = "SELECT objectId, chunkId FROM " + makeTableName(tblidx)
+    + " WHERE objectId IN (";
+  for (size_t i=first; i<last; i++) {
+    if (i>first) query += ',';
+    appendID(query, index[order[i]]);
+  }
+  query += ')';
+
+  nQueries++;
+  nQueryIDs += last-first;
+
+  sendQuery(query);
+  readRows(index, chunk, first, last);
+}
+
+void MysqlIndex::findByJoin(int tblidx, const objectId_t* index,
+			    chunkId_t* chunk, size_t first, size_t last) {
+  if (!haveJoinTable) {
+    sendQuery("CREATE TEMPORARY TABLE lookupIds (objectId BIGINT NOT NULL"
+	      " PRIMARY KEY) ENGINE=MEMORY");
+    haveJoinTable = true;
+  }
+
+  // Insert IDs in groups, to stay well below server's packet limit
+  for (size_t start=first; start<last; start+=joinThreshold) {
+    size_t end = std::min(start+joinThreshold, last);
+    query = "INSERT IGNORE INTO lookupIds VALUES ";
+    for (size_t i=start; i<end; i++) {
+      query += (i>start) ? ",(" : "(";
+      appendID(query, index[order[i]]);
+      query += ')';
+    }
+    sendQuery(query);
+  }
+
+  nQueries++;
+  nQueryIDs += last-first;
+  nJoins++;
+
+  sendQuery("SELECT t.objectId, t.chunkId FROM " + makeTableName(tblidx)
+	    + " AS t JOIN lookupIds USING (objectId)");
+  readRows(index, chunk, first, last);
+
+  sendQuery("TRUNCATE TABLE lookupIds");
+}
+
+// Rows are not buffered by client; each is matched to all requests for it
+
+void MysqlIndex::readRows(const objectId_t* index, chunkId_t* chunk,
+			  size_t first, size_t last) {
+  MYSQL_RES* result = mysql_use_result(mysqlDB);
+  if (!result) {
+    reportError();
+    return;
+  }
+
+  vector<size_t>::iterator begin = order.begin()+first;
+  vector<size_t>::iterator end = order.begin()+last;
+
+  MYSQL_ROW row;
+  while ((row = mysql_fetch_row(result))) {
+    objectId_t objID = strtoull(row[0], 0, 0);
+    chunkId_t chunkID = strtoul(row[1], 0, 0);
+
+    vector<size_t>::iterator pos =
+      lower_bound(begin, end, objID,
+		  [index](size_t i, objectId_t id) { return index[i] < id; });
+    for (; pos != end && index[*pos] == objID; ++pos) chunk[*pos] = chunkID;
+  }
+
+  reportError();				// NULL row may be an error
+  mysql_free_result(result);
+}
+
+
+// Append batch query statistics
+
+void MysqlIndex::reportHeadings(std::ostream& csv) const {
+  csv << ", Batch size, Queries, IDs/query, Join queries, Load threads";
+}
+
+void MysqlIndex::reportColumns(std::ostream& csv) const {
+  csv << ", " << batchSize << ", " << nQueries << ", "
+      << (nQueries>0 ? (double)nQueryIDs/nQueries : 0.) << ", " << nJoins
+      << ", " << (loadThreads>0 ? loadThreads : 1);
+}
+
+
 MYSQL_RES* MysqlIndex::getQueryResult() const {
   MYSQL_RES *result = mysql_store_result(mysqlDB);
 
@@ -6,9 +6,14 @@
 // 20160119  Michael Kelsey
 // 20160204  Extend to support blocking data into smaller tables
 // 20160216  Add support for doing "bulk updates" from flat files
+// 20261017  Add lookups with prepared statements (binary protocol)
+// 20261017  Add batched lookups, with IN-list or temporary table join
+// 20261017  Add parallel loading of block tables, one connection per thread
+// 20261017  Share connection setup between main and loader connections
 
 #include "IndexTester.hh"
 #include <mysql/mysql.h>	/* Needed for MYSQL typedef below */
+#include <atomic>
 #include <string>
 #include <vector>
 
@@ -22,20 +27,44 @@ public:
   // Call this function before running to create multiple smaller tables
   void setTableSize(objectId_t max=0ULL) { blockSize = max; }
 
+  // Use one prepared statement per table, with binary result binding
+  void setPrepared(bool prep=true);
+
+  // Batches with this many objectIDs in one table are loaded into a
+  // temporary table and joined, rather than listed in the query
+  void setJoinThreshold(size_t n=10000) { joinThreshold = (n>0) ? n : 1; }
+
+  // Load block tables concurrently, each thread with its own connection;
+  // "local" streams generated rows with LOAD DATA LOCAL, without files
+  void setParallelLoad(int threads=4, bool local=true);
+
 protected:
   virtual void create(objectId_t asize);
   virtual void update(const char* datafile);
   virtual chunkId_t value(objectId_t objID);
+  virtual void values(const objectId_t* index, chunkId_t* chunk, size_t n);
   virtual void cleanup();
 
+  virtual void reportHeadings(std::ostream& csv) const;
+  virtual void reportColumns(std::ostream& csv) const;
+
   bool connect(const std::string& newDBname="");
+  MYSQL* openConnection(const std::string& db, bool localInfile=false) const;
+  void updateName();				// Reflects lookup and load modes
   void accessDatabase() const;
 
   void createTables() const;			// One for all, or multiple
   void createTable(int tblidx=-1) const;	// >= 0 allows data blocks
-  void fillTable(int tblidx, objectId_t tsize, objectId_t firstID) const;
+  void fillTable(int tblidx, objectId_t tsize, objectId_t firstID,
+		 MYSQL* db=0) const;
 
-  void updateTable(const char* datafile, int tblidx=-1) const;
+  void updateTable(const char* datafile, int tblidx=-1, MYSQL* db=0) const;
+
+  // Parallel loading:  threads take tables in turn until all are filled
+  void loadTables() const;
+  void loadThread(std::atomic<int>* nextTable) const;
+  void streamTable(MYSQL* db, int tblidx, objectId_t tsize,
+		   objectId_t firstID) const;
 
   void getObjectRange(int tblidx, objectId_t &minID, objectId_t &maxID) const;
 
@@ -46,6 +75,18 @@ protected:
 
   MYSQL_RES* findObjectID(objectId_t objID) const;  // Get chunk for given ID
 
+  void prepareStatements();			// One lookup per table
+  void closeStatements();
+  chunkId_t findPrepared(objectId_t objID);	// Uses bound buffers
+
+  // Batch lookups in one table, for sorted positions [first,last)
+  void findByList(int tblidx, const objectId_t* index, chunkId_t* chunk,
+		  size_t first, size_t last);
+  void findByJoin(int tblidx, const objectId_t* index, chunkId_t* chunk,
+		  size_t first, size_t last);
+  void readRows(const objectId_t* index, chunkId_t* chunk,
+		size_t first, size_t last);	// Streams result rows
+
   // Wrapper functions to handle multiple tables for data blocks
 
   bool usingMultipleTables() const {		// Flag if data is in blocks
@@ -62,8 +103,9 @@ protected:
 
   // Wrapper functions to generate and process queries
 
-  void sendQuery(const std::string& query) const;  // Transmit query to server
-  void reportError() const;			// Print MySQL message if any
+  // Connection is mysqlDB unless specified
+  void sendQuery(const std::string& query, MYSQL* db=0) const;
+  void reportError(MYSQL* db=0) const;		// Print MySQL message if any
   MYSQL_RES* getQueryResult() const;		// Result container w/err check
 
   chunkId_t extractChunk(MYSQL_RES* result, size_t irow=0) const;
@@ -76,6 +118,25 @@ protected:
 
   objectId_t blockSize;			// For dividing overly large tables
   std::vector<objectId_t> blockStart;	// Lowest objectID in each table block
+
+  bool prepared;
+  std::vector<MYSQL_STMT*> lookupStmt;	// Indexed by table block
+  MYSQL_BIND lookupParam;		// Bound to lookupID, lookupChunk
+  MYSQL_BIND lookupResult;
+  unsigned long long lookupID;
+  unsigned int lookupChunk;
+
+  int loadThreads;			// Zero for sequential loading
+  bool localLoad;
+  std::string fullName;
+
+  size_t joinThreshold;
+  bool haveJoinTable;			// Temporary, dropped on disconnect
+  std::vector<size_t> order;		// Batch positions sorted by objectID
+  std::string query;			// Reused for batch queries
+  long nQueries;
+  long nQueryIDs;
+  long nJoins;
 };
 
 #endif	/* MYSQL_INDEX_HH */
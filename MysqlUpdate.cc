@@ -3,6 +3,7 @@
 //
 // 20160217  Michael Kelsey -- sets bulk data file automatically
 // 20160224  Add parameter for size of bulk-update file, cleanup() function
+// 20261017  Append subclass columns to CSV output, as in base
 
 #include "MysqlUpdate.hh"
 #include "UsageTimer.hh"
@@ -43,7 +44,9 @@ void MysqlUpdate::TestAndReport(objectId_t asize, long usize,
   if (asize == 0) {		// Special case: print column headings
     csv << "Type, Size (1e6), Init CPU (s), Init Clock (s)"
 	<< ", Update (1e6), Update CPU (s), Update Clock (s)"
-	<< ", Memory (MB), Page fault, Input op" << std::endl;
+	<< ", Memory (MB), Page fault, Input op";
+    reportHeadings(csv);
+    csv << std::endl;
     return;
   }
 
@@ -59,8 +62,9 @@ void MysqlUpdate::TestAndReport(objectId_t asize, long usize,
   UpdateTable(bulkfile);
   csv << ", " << bulksize/1e6 << ", " << GetUsage().cpuTime()
       << ", " << GetUsage().elapsed() << ", " << GetUsage().maxMemory()/1e6
-      << ", " << GetUsage().pageFaults() << ", " << GetUsage().ioInput()
-      << std::endl;
+      << ", " << GetUsage().pageFaults() << ", " << GetUsage().ioInput();
+  reportColumns(csv);
+  csv << std::endl;
 
   cleanup();			// Remove job-specific data before next pass
 }
@@ -0,0 +1,309 @@
+// $Id$
+// NumaIndex.cc -- Run another in-memory lookup table on each NUMA node,
+// either replicated (full copy per node) or partitioned by objectId range,
+// with a query thread pinned to each node serving its share of batches.
+//
+// 20261017  Michael Kelsey
+
+#include "NumaIndex.hh"
+#include <sched.h>
+#include <algorithm>
+#include <iostream>
+#ifdef HAS_NUMA
+#include <numa.h>
+#endif
+
+
+// Constructor and destructor
+
+NumaIndex::NumaIndex(Factory make, Mode m, int verbose)
+  : IndexTester("numa",verbose), factory(make), mode(m), nNodes(1),
+    nPhysical(1), prototype(0), partSize(0ULL) {
+#ifdef HAS_NUMA
+  if (numa_available() >= 0) nPhysical = numa_max_node()+1;
+#endif
+  nNodes = nPhysical;
+
+  prototype = factory();
+  fullName = (mode == Partition) ? "partition+" : "replicate+";
+  if (prototype) fullName += prototype->GetName();
+  SetName(fullName.c_str());
+
+  SetBatchSize(4096);			// Single queries are not routed
+}
+
+NumaIndex::~NumaIndex() {
+  cleanup();
+  stopWorkers();
+  delete prototype;
+}
+
+void NumaIndex::setNodes(int n) {
+  stopWorkers();
+  nNodes = (n > 0) ? n : nPhysical;
+}
+
+
+// Parse mode from name, as "replicate" or "partition"
+
+bool NumaIndex::knownMode(const std::string& name) {
+  return (name == "replicate" || name == "partition");
+}
+
+NumaIndex::Mode NumaIndex::modeFromName(const std::string& name) {
+  return (name == "partition") ? Partition : Replicate;
+}
+
+
+// Build table on each node, in parallel; each node's table is allocated
+// by its own pinned thread, so that memory is local to the node
+
+void NumaIndex::create(objectId_t asize) {
+  cleanup();				// Discard previous tables
+  startWorkers();
+
+  partSize = (mode == Partition) ? (asize + nNodes-1) / nNodes : asize;
+
+  for (int i=0; i<nNodes; i++) {
+    Worker* w = workers[i];
+    objectId_t first = (mode == Partition) ? i*partSize : 0;
+    w->createSize = (first < asize) ? std::min(partSize, asize-first) : 0;
+    w->nQueries = 0;
+    post(w, Create);
+  }
+
+  for (int i=0; i<nNodes; i++) wait(workers[i]);
+
+  // Table may have forced dense indices
+  if (workers[0]->table) SetIndexSpacing(workers[0]->table->GetIndexSpacing());
+
+  if (verboseLevel>1) {
+    std::cout << " " << nNodes << " nodes (" << nPhysical << " physical), "
+	      << partSize << " keys per node" << std::endl;
+  }
+}
+
+void NumaIndex::cleanup() {
+  for (size_t i=0; i<workers.size(); i++) post(workers[i], Destroy);
+  for (size_t i=0; i<workers.size(); i++) wait(workers[i]);
+  partSize = 0;
+}
+
+
+// Single query is done in calling thread, using local replica or the
+// partition holding the objectId
+
+chunkId_t NumaIndex::value(objectId_t index) {
+  if (workers.empty()) return 0xdeadbeef;
+
+  Worker* w = 0;
+  if (mode == Partition) {
+    size_t inode = nodeOf(index);
+    w = workers[inode];
+    index -= inode*partSize*indexStep;
+  } else {
+    w = workers[currentNode() % nNodes];
+  }
+
+  w->nQueries++;
+  return (w->table ? valueOf(w->table, index) : 0xdeadbeef);
+}
+
+
+// Batch is split among nodes:  replicas each take a contiguous share,
+// partitions take the objectIds in their range
+
+void NumaIndex::values(const objectId_t* index, chunkId_t* chunk, size_t n) {
+  if (workers.empty()) {
+    for (size_t i=0; i<n; i++) chunk[i] = 0xdeadbeef;
+    return;
+  }
+
+  if (mode == Replicate) {
+    for (int k=0; k<nNodes; k++) {
+      Worker* w = workers[k];
+      size_t begin = n*k/nNodes, end = n*(k+1)/nNodes;
+      w->index = index + begin;
+      w->chunk = chunk + begin;
+      w->n = end - begin;
+      post(w, Lookup);
+    }
+
+    for (int k=0; k<nNodes; k++) wait(workers[k]);
+    return;
+  }
+
+  for (int k=0; k<nNodes; k++) {
+    partIndex[k].clear();
+    partPos[k].clear();
+  }
+
+  for (size_t i=0; i<n; i++) {
+    size_t k = nodeOf(index[i]);
+    partIndex[k].push_back(index[i] - k*partSize*indexStep);
+    partPos[k].push_back(i);
+  }
+
+  for (int k=0; k<nNodes; k++) {
+    Worker* w = workers[k];
+    partChunk[k].resize(partIndex[k].size());
+    w->index = partIndex[k].empty() ? 0 : &partIndex[k][0];
+    w->chunk = partChunk[k].empty() ? 0 : &partChunk[k][0];
+    w->n = partIndex[k].size();
+    post(w, Lookup);
+  }
+
+  for (int k=0; k<nNodes; k++) {
+    wait(workers[k]);
+    for (size_t j=0; j<partPos[k].size(); j++) {
+      chunk[partPos[k][j]] = partChunk[k][j];
+    }
+  }
+}
+
+
+// Partition holding objectId; out of range goes to last partition
+
+size_t NumaIndex::nodeOf(objectId_t index) const {
+  objectId_t entry = index / indexStep;
+  size_t k = (partSize > 0) ? entry / partSize : 0;
+  return (k < (size_t)nNodes) ? k : nNodes-1;
+}
+
+int NumaIndex::currentNode() const {
+#ifdef HAS_NUMA
+  if (nPhysical > 1) {
+    int node = numa_node_of_cpu(sched_getcpu());
+    if (node >= 0) return node;
+  }
+#endif
+  return 0;
+}
+
+
+// One worker thread per node, kept between table sizes
+
+void NumaIndex::startWorkers() {
+  if (!workers.empty()) return;
+
+  for (int i=0; i<nNodes; i++) {
+    Worker* w = new Worker;
+    w->node = i % nPhysical;
+    w->table = 0;
+    w->task = Idle;
+    w->createSize = 0;
+    w->index = 0;
+    w->chunk = 0;
+    w->n = 0;
+    w->nQueries = 0;
+    workers.push_back(w);
+    w->thread = std::thread(&NumaIndex::workerLoop, this, w);
+  }
+
+  partIndex.resize(nNodes);
+  partChunk.resize(nNodes);
+  partPos.resize(nNodes);
+}
+
+void NumaIndex::stopWorkers() {
+  for (size_t i=0; i<workers.size(); i++) {
+    post(workers[i], Destroy);
+    wait(workers[i]);
+    post(workers[i], Exit);
+    workers[i]->thread.join();
+    delete workers[i];
+  }
+
+  workers.clear();
+  partIndex.clear();
+  partChunk.clear();
+  partPos.clear();
+}
+
+
+// Pin thread to its node, with memory allocated locally, then run tasks
+
+void NumaIndex::workerLoop(Worker* w) {
+#ifdef HAS_NUMA
+  if (numa_available() >= 0) {
+    if (numa_run_on_node(w->node) != 0) perror("NumaIndex numa_run_on_node");
+    numa_set_localalloc();
+  }
+#endif
+
+  std::unique_lock<std::mutex> guard(w->lock);
+  while (true) {
+    while (w->task == Idle) w->wake.wait(guard);
+    if (w->task == Exit) break;
+
+    guard.unlock();
+    runTask(w);
+    guard.lock();
+
+    w->task = Idle;
+    w->done.notify_one();
+  }
+}
+
+void NumaIndex::runTask(Worker* w) {
+  switch (w->task) {
+  case Create:
+    if (!w->table) w->table = factory();
+    if (!w->table) break;
+    w->table->SetVerboseLevel(verboseLevel>1 ? verboseLevel-1 : 0);
+    w->table->SetIndexSpacing(indexStep);
+    w->table->CreateTable(w->createSize);
+    break;
+  case Lookup:
+    if (w->n == 0) break;
+    if (w->table) valuesOf(w->table, w->index, w->chunk, w->n);
+    else for (size_t i=0; i<w->n; i++) w->chunk[i] = 0xdeadbeef;
+    w->nQueries += w->n;
+    break;
+  case Destroy:
+    delete w->table;
+    w->table = 0;
+    break;
+  default: break;
+  }
+}
+
+
+// Hand task to worker, and wait for it to be finished
+
+void NumaIndex::post(Worker* w, Task task) {
+  {
+    std::lock_guard<std::mutex> guard(w->lock);
+    w->task = task;
+  }
+  w->wake.notify_one();
+}
+
+void NumaIndex::wait(Worker* w) {
+  std::unique_lock<std::mutex> guard(w->lock);
+  while (w->task != Idle) w->done.wait(guard);
+}
+
+
+// Append node configuration and queries served by each node, then the
+// first node's table columns
+
+void NumaIndex::reportHeadings(std::ostream& csv) const {
+  csv << ", Nodes, Physical nodes, Queries per node";
+  if (prototype) headingsOf(prototype, csv);
+}
+
+void NumaIndex::reportColumns(std::ostream& csv) const {
+  csv << ", " << nNodes << ", " << nPhysical << ", ";
+  for (size_t i=0; i<workers.size(); i++) {
+    csv << (i>0 ? "/" : "") << workers[i]->nQueries;
+  }
+
+  if (prototype) {
+    if (!workers.empty() && workers[0]->table) {
+      columnsOf(workers[0]->table, csv);
+    } else {
+      columnsOf(prototype, csv);
+    }
+  }
+}
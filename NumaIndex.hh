@@ -0,0 +1,93 @@
+#ifndef NUMA_INDEX_HH
+#define NUMA_INDEX_HH 1
+// $Id$
+// NumaIndex.hh -- Run another in-memory lookup table on each NUMA node,
+// either replicated (full copy per node) or partitioned by objectId range,
+// with a query thread pinned to each node serving its share of batches.
+//
+// 20261017  Michael Kelsey
+
+#include "IndexTester.hh"
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+class NumaIndex : public IndexTester {
+public:
+  enum Mode { Replicate, Partition };
+
+  // Factory creates table for each node, in that node's pinned thread
+  typedef std::function<IndexTester*()> Factory;
+
+  NumaIndex(Factory factory, Mode mode=Replicate, int verbose=0);
+  virtual ~NumaIndex();
+
+  void setNodes(int n=0);		// Zero uses all nodes; more will wrap
+
+  static bool knownMode(const std::string& name);	// "replicate", etc.
+  static Mode modeFromName(const std::string& name);
+
+protected:
+  virtual void create(objectId_t asize);
+  virtual chunkId_t value(objectId_t index);
+  virtual void values(const objectId_t* index, chunkId_t* chunk, size_t n);
+  virtual void cleanup();
+
+  virtual void reportHeadings(std::ostream& csv) const;
+  virtual void reportColumns(std::ostream& csv) const;
+
+  enum Task { Idle, Create, Lookup, Destroy, Exit };
+
+  // Worker thread and table for one node
+  struct Worker {
+    int node;				// Physical NUMA node
+    IndexTester* table;
+    std::thread thread;
+
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable done;
+    Task task;
+
+    objectId_t createSize;		// For Create
+    const objectId_t* index;		// For Lookup
+    chunkId_t* chunk;
+    size_t n;
+
+    long nQueries;
+  };
+
+  void startWorkers();
+  void stopWorkers();
+  void workerLoop(Worker* w);
+  void runTask(Worker* w);
+
+  void post(Worker* w, Task task);	// Start task on worker
+  void wait(Worker* w);			// Wait for task to finish
+
+  size_t nodeOf(objectId_t index) const;	// For partitioned table
+  int currentNode() const;
+
+private:
+  Factory factory;
+  Mode mode;
+  int nNodes;				// Workers; may exceed physical nodes
+  int nPhysical;
+
+  IndexTester* prototype;		// For CSV headings
+  std::string fullName;
+
+  std::vector<Worker*> workers;
+  objectId_t partSize;			// Keys per partition
+
+  // Scatter/gather buffers for partitioned batches, one per node
+  std::vector<std::vector<objectId_t> > partIndex;
+  std::vector<std::vector<chunkId_t> > partChunk;
+  std::vector<std::vector<size_t> > partPos;
+};
+
+#endif	/* NUMA_INDEX_HH */
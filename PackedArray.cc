@@ -0,0 +1,131 @@
+// $Id$
+// PackedArray.cc -- Array of fixed-width unsigned integers, packed into
+// 64-bit words with no padding between values.
+//
+// 20261017  Michael Kelsey
+// 20261017  Static access to raw words; batch gather, using AVX2 if the
+//	     processor has it
+
+#include "PackedArray.hh"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PACKED_AVX2 1
+#endif
+
+
+// Constructor
+
+PackedArray::PackedArray(size_t n, unsigned width)
+  : words(0), nWords(0), count(0), nbits(0) {
+  resize(n, width);
+}
+
+
+// Allocate new (zero-filled) storage; zero width stores only zeroes
+
+void PackedArray::resize(size_t n, unsigned width) {
+  clear();
+
+  count = n;
+  nbits = (width > 64) ? 64 : width;
+
+  nWords = wordsFor(count, nbits);
+  words = new uint64_t[nWords]();
+}
+
+void PackedArray::clear() {
+  delete[] words;
+  words = 0;
+  nWords = count = 0;
+  nbits = 0;
+}
+
+
+// Number of bits needed to represent given value
+
+unsigned PackedArray::bitsFor(uint64_t maxValue) {
+  return (maxValue == 0) ? 0 : 64 - __builtin_clzll(maxValue);
+}
+
+
+// Overwrite value in place, which may span two words
+
+void PackedArray::set(uint64_t* words, size_t i, unsigned width,
+		      uint64_t val) {
+  if (width == 0) return;
+
+  uint64_t mask = maskFor(width);
+  val &= mask;
+  size_t bit = i*width;
+  unsigned shift = bit & 63;
+  uint64_t* w = words + (bit >> 6);
+
+  w[0] = (w[0] & ~(mask << shift)) | (val << shift);
+  if (shift + width > 64) {
+    unsigned spill = 64 - shift;
+    w[1] = (w[1] & ~(mask >> spill)) | (val >> spill);
+  }
+}
+
+
+// Four lookups at a time:  one gather instruction does the unaligned
+// loads, then each lane is shifted and masked, and packed to 32 bits
+
+#ifdef PACKED_AVX2
+namespace {
+  __attribute__((target("avx2")))
+  size_t gatherAVX2(const uint64_t* words, unsigned width, size_t limit,
+		    const unsigned long long* pos, size_t n, uint32_t* out,
+		    uint32_t missing) {
+    const __m256i mask = _mm256_set1_epi64x(PackedArray::maskFor(width));
+    const __m256i low32 = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+    const __m128i absent = _mm_set1_epi32(missing);
+
+    size_t i = 0;
+    for (; i+4 <= n; i+=4) {
+      long long offset[4], shift[4];
+      int found[4];
+      for (int j=0; j<4; j++) {
+	found[j] = (pos[i+j] < limit) ? -1 : 0;
+	uint64_t bit = found[j] ? pos[i+j]*width : 0;
+	offset[j] = bit >> 3;
+	shift[j] = bit & 7;
+      }
+
+      __m256i val =
+	_mm256_i64gather_epi64((const long long*)words,
+			       _mm256_loadu_si256((const __m256i*)offset), 1);
+      val = _mm256_srlv_epi64(val,_mm256_loadu_si256((const __m256i*)shift));
+      val = _mm256_and_si256(val, mask);
+
+      __m128i chunks =
+	_mm256_castsi256_si128(_mm256_permutevar8x32_epi32(val, low32));
+      chunks = _mm_blendv_epi8(absent, chunks,
+			       _mm_loadu_si128((const __m128i*)found));
+      _mm_storeu_si128((__m128i*)(out+i), chunks);
+    }
+
+    return i;
+  }
+}
+#endif
+
+
+// Look up values at positions, with "missing" for positions past limit
+
+void PackedArray::gather(const uint64_t* words, unsigned width, size_t limit,
+			 const unsigned long long* pos, size_t n,
+			 uint32_t* out, uint32_t missing) {
+  size_t i = 0;
+
+#ifdef PACKED_AVX2
+  static const bool hasAVX2 = __builtin_cpu_supports("avx2");
+  if (hasAVX2 && width > 0 && width <= 32) {
+    i = gatherAVX2(words, width, limit, pos, n, out, missing);
+  }
+#endif
+
+  for (; i<n; i++) {			// Remainder, or no SIMD available
+    out[i] = (pos[i] < limit) ? get(words, pos[i], width) : missing;
+  }
+}
@@ -0,0 +1,82 @@
+#ifndef PACKED_ARRAY_HH
+#define PACKED_ARRAY_HH 1
+// $Id$
+// PackedArray.hh -- Array of fixed-width unsigned integers, packed into
+// 64-bit words with no padding between values.
+//
+// 20261017  Michael Kelsey
+// 20261017  Unaligned single-load extraction; static access to raw words
+//	     for callers which manage their own storage; batch gather
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+
+class PackedArray {
+public:
+  PackedArray(size_t n=0, unsigned width=0);
+  ~PackedArray() { clear(); }
+
+  void resize(size_t n, unsigned width);	// Discards data, zero-filled
+  void clear();
+
+  size_t size() const { return count; }
+  unsigned width() const { return nbits; }
+  size_t bytes() const { return nWords*sizeof(uint64_t); }
+
+  static unsigned bitsFor(uint64_t maxValue);	// Width to store value
+
+  uint64_t get(size_t i) const { return get(words, i, nbits); }
+  void set(size_t i, uint64_t val) { set(words, i, nbits, val); }
+
+  // Look up values at positions; those at or past size() give "missing"
+  void gather(const unsigned long long* pos, size_t n, uint32_t* out,
+	      uint32_t missing) const {
+    gather(words, nbits, count, pos, n, out, missing);
+  }
+
+  // Access to caller's storage, which must have wordsFor(n,width) words
+  static size_t wordsFor(size_t n, unsigned width) {
+    return (n*width + 63) / 64 + 1;		// Extra word for get()
+  }
+
+  static uint64_t maskFor(unsigned width) {
+    return (width >= 64) ? ~0ULL : (1ULL << width) - 1;
+  }
+
+  // Up to 57 bits fit in one unaligned load from the first byte; the
+  // extra word at the end keeps the load inside the array
+  static uint64_t get(const uint64_t* words, size_t i, unsigned width) {
+    size_t bit = i*width;
+    unsigned shift = bit & 7;
+    uint64_t val;
+    if (width <= 57) {
+      memcpy(&val, (const char*)words + (bit >> 3), sizeof(val));
+      return (val >> shift) & maskFor(width);
+    }
+
+    shift = bit & 63;				// Values may span two words
+    const uint64_t* w = words + (bit >> 6);
+    val = w[0] >> shift;
+    if (shift + width > 64) val |= w[1] << (64-shift);
+    return val & maskFor(width);
+  }
+
+  static void set(uint64_t* words, size_t i, unsigned width, uint64_t val);
+
+  static void gather(const uint64_t* words, unsigned width, size_t limit,
+		     const unsigned long long* pos, size_t n, uint32_t* out,
+		     uint32_t missing);
+
+private:
+  PackedArray(const PackedArray&);		// Copying is not supported
+  PackedArray& operator=(const PackedArray&);
+
+  uint64_t* words;
+  size_t nWords;
+  size_t count;
+  unsigned nbits;
+};
+
+#endif	/* PACKED_ARRAY_HH */
@@ -0,0 +1,145 @@
+// $Id$
+// PageAlloc.cc -- Allocate large zero-filled arrays directly from the OS,
+// optionally backed by transparent huge pages to reduce TLB misses.
+//
+// 20261017  Michael Kelsey
+// 20261017  Select page policy, including explicit (hugetlbfs) huge pages,
+//	     with fallback when they are not available
+
+#include "PageAlloc.hh"
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <fstream>
+#include <string>
+
+// NOTE:  MacOSX uses MAP_ANON rather than MAP_ANONYMOUS
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+// NOTE:  Older C libraries do not define page size selection flags
+#if defined(MAP_HUGETLB) && !defined(MAP_HUGE_SHIFT)
+#define MAP_HUGE_SHIFT 26
+#endif
+
+namespace {
+  const size_t hugePageSize = 2UL*1024*1024;
+  const size_t gigaPageSize = 1UL*1024*1024*1024;
+
+  size_t roundUp(size_t nbytes, size_t unit) {
+    return (nbytes + unit-1) / unit * unit;
+  }
+
+  // Transparent huge pages may be disabled system-wide
+  bool haveTHP() {
+#ifdef MADV_HUGEPAGE
+    static int enabled = -1;
+    if (enabled < 0) {
+      std::ifstream sys("/sys/kernel/mm/transparent_hugepage/enabled");
+      std::string mode;
+      getline(sys, mode);
+      enabled = (mode.find("[never]") == std::string::npos);
+    }
+    return enabled;
+#else
+    return false;
+#endif
+  }
+
+  // Explicit huge pages come from reserved pool; mmap() fails if the pool
+  // does not have enough pages
+  void* mapHugeTLB(size_t length, size_t page) {
+#ifdef MAP_HUGETLB
+    int log2page = __builtin_ctzl(page);
+    void* addr = mmap(0, length, PROT_READ|PROT_WRITE,
+		      MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB |
+		      (log2page << MAP_HUGE_SHIFT), -1, 0);
+    return (addr == MAP_FAILED) ? 0 : addr;
+#else
+    return 0;
+#endif
+  }
+}
+
+
+size_t pageSize(PagePolicy policy) {
+  switch (policy) {
+  case Huge1G:  return gigaPageSize;
+  case Huge2M:
+  case HugeTHP: return hugePageSize;
+  default: break;
+  }
+
+  return sysconf(_SC_PAGESIZE);
+}
+
+
+// Anonymous mappings are zero-filled; huge pages need aligned regions,
+// so extra space is mapped and the unaligned ends are returned
+
+void* allocatePages(size_t nbytes, PagePolicy& policy) {
+  if (nbytes == 0) return 0;
+
+  while (policy == Huge1G || policy == Huge2M) {
+    void* addr = mapHugeTLB(roundUp(nbytes, pageSize(policy)),
+			    pageSize(policy));
+    if (addr) return addr;
+
+    policy = (policy == Huge1G) ? Huge2M : HugeTHP;	// Quietly fall back
+  }
+
+  if (policy == HugeTHP && !haveTHP()) policy = SmallPages;
+
+  bool huge = (policy == HugeTHP);
+  size_t length = roundUp(nbytes, pageSize(policy));
+  size_t extra = huge ? hugePageSize : 0;
+
+  void* addr = mmap(0, length+extra, PROT_READ|PROT_WRITE,
+		    MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+  if (addr == MAP_FAILED) {
+    perror("allocatePages mmap");
+    return 0;
+  }
+
+  if (!huge) return addr;
+
+  uintptr_t start = (uintptr_t)addr;
+  uintptr_t aligned = roundUp(start, hugePageSize);
+  if (aligned > start) munmap(addr, aligned-start);
+  if (extra > aligned-start)
+    munmap((void*)(aligned+length), extra-(aligned-start));
+
+#ifdef MADV_HUGEPAGE
+  if (madvise((void*)aligned, length, MADV_HUGEPAGE) != 0)
+    perror("allocatePages madvise");		// Not fatal, small pages used
+#endif
+
+  return (void*)aligned;
+}
+
+void freePages(void* addr, size_t nbytes, PagePolicy policy) {
+  if (addr) munmap(addr, roundUp(nbytes, pageSize(policy)));
+}
+
+
+// Policy names, used in type strings and CSV output
+
+const char* pagePolicyName(PagePolicy policy) {
+  switch (policy) {
+  case HugeTHP: return "thp";
+  case Huge2M:  return "huge2m";
+  case Huge1G:  return "huge1g";
+  default: break;
+  }
+
+  return "small";
+}
+
+PagePolicy pagePolicyFromName(const std::string& type) {
+  if (type.find("huge1g") != std::string::npos) return Huge1G;
+  if (type.find("huge2m") != std::string::npos) return Huge2M;
+  if (type.find("thp") != std::string::npos)    return HugeTHP;
+  return SmallPages;
+}
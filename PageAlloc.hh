@@ -0,0 +1,31 @@
+#ifndef PAGE_ALLOC_HH
+#define PAGE_ALLOC_HH 1
+// $Id$
+// PageAlloc.hh -- Allocate large zero-filled arrays directly from the OS,
+// optionally backed by transparent huge pages to reduce TLB misses.
+//
+// 20261017  Michael Kelsey
+// 20261017  Select page policy, including explicit (hugetlbfs) huge pages,
+//	     with fallback when they are not available
+
+#include <stddef.h>
+#include <string>
+
+// Page policies, from smallest to largest pages
+enum PagePolicy { SmallPages, HugeTHP, Huge2M, Huge1G };
+
+// Policy is changed to what was actually used, falling back from explicit
+// huge pages to transparent huge pages to small pages; pass the same
+// arguments to freePages() as were returned from allocatePages()
+
+void* allocatePages(size_t nbytes, PagePolicy& policy);
+void freePages(void* addr, size_t nbytes, PagePolicy policy);
+
+size_t pageSize(PagePolicy policy);
+
+// Names are "small", "thp", "huge2m", "huge1g"; FromName() looks for any
+// of them in a type string (e.g., "array-huge2m"), default is "small"
+const char* pagePolicyName(PagePolicy policy);
+PagePolicy pagePolicyFromName(const std::string& type);
+
+#endif	/* PAGE_ALLOC_HH */
@@ -0,0 +1,265 @@
+// $Id$
+// PerfectHashIndex.cc -- Exercise performance of minimal perfect hash
+// function (BBHash style) over static key set as lookup table.  Each key
+// maps to a unique slot in bit-packed fingerprint and chunk arrays.
+//
+// 20261017  Michael Kelsey
+// 20261017  Generate keys for first level, rather than copying key set
+// 20261017  Limit fingerprint width to 1-32 bits
+
+#include "PerfectHashIndex.hh"
+#include "HashFunctions.hh"
+#include <cmath>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+
+// Run function over range [0,n) split among threads; function is
+// called as func(begin, end, ithread)
+
+namespace {
+  template <class Func>
+  void parallelFor(uint64_t n, unsigned nThreads, Func func) {
+    if (nThreads < 2 || n < 100000) {		// Not worth starting threads
+      func(0ULL, n, 0U);
+      return;
+    }
+
+    std::vector<std::thread> threads;
+    for (unsigned t=0; t<nThreads; t++) {
+      threads.push_back(std::thread(func, n*t/nThreads, n*(t+1)/nThreads, t));
+    }
+
+    for (unsigned t=0; t<nThreads; t++) threads[t].join();
+  }
+}
+
+
+// Constructor and destructor
+
+PerfectHashIndex::PerfectHashIndex(int verbose)
+  : IndexTester("mphf",verbose), gamma(2.), nThreads(1), fpBits(8),
+    nKeys(0ULL) {
+  setThreads(0);
+}
+
+void PerfectHashIndex::cleanup() {
+  std::vector<uint64_t>().swap(bits);	// Releases memory, unlike clear()
+  std::vector<uint64_t>().swap(blockRank);
+  levelStart.clear();
+  levelSize.clear();
+  fallback.clear();
+
+  fingerprints.clear();
+  chunks.clear();
+  nKeys = 0;
+}
+
+void PerfectHashIndex::setThreads(unsigned n) {
+  nThreads = (n>0) ? n : std::thread::hardware_concurrency();
+  if (nThreads == 0) nThreads = 1;	// Unknown hardware
+}
+
+// Zero width would shift by 64 bits in fingerprint()
+
+void PerfectHashIndex::setFingerprintBits(unsigned bits) {
+  fpBits = (bits<1) ? 1 : (bits>32) ? 32 : bits;
+}
+
+
+// Build hash function over full range of keys, then fill payload
+
+void PerfectHashIndex::create(objectId_t asize) {
+  cleanup();				// Discard previous table
+  if (asize == 0) return;
+
+  nKeys = asize;
+
+  buildUsage.zero();
+  buildUsage.start();
+  buildHash();
+  buildUsage.end();
+
+  chunkGen.reset();
+  chunks.resize(nKeys, PackedArray::bitsFor(chunkGen.maxChunk()));
+  fingerprints.resize(nKeys, fpBits);
+
+  for (objectId_t i=0; i<nKeys; i++) {
+    objectId_t key = i*indexStep;
+    uint64_t islot = slot(key);
+    fingerprints.set(islot, fingerprint(key));
+    chunks.set(islot, chunkGen.next());
+  }
+
+  if (verboseLevel>1) {
+    std::cout << "PerfectHashIndex " << nKeys << " keys, " << levelSize.size()
+	      << " levels, " << fallback.size() << " unplaced, "
+	      << hashBits() << " bits/key, build " << buildUsage << std::endl;
+  }
+}
+
+
+// Assign keys which do not collide at this level; others are returned
+
+template <class KeySource>
+void PerfectHashIndex::buildLevel(uint64_t n, KeySource key,
+				  std::vector<objectId_t>& left) {
+  uint64_t level = levelSize.size();
+  uint64_t size = ((uint64_t)ceil(gamma*n) + 63) / 64 * 64;
+  uint64_t start = bits.size()*64;
+
+  levelStart.push_back(start);
+  levelSize.push_back(size);
+  bits.resize((start+size)/64, 0ULL);
+
+  // Mark each position hit, and each hit more than once
+  std::vector<uint64_t> seen(size/64, 0ULL), collide(size/64, 0ULL);
+
+  parallelFor(n, nThreads, [&](uint64_t begin, uint64_t end, unsigned) {
+    for (uint64_t i=begin; i<end; i++) {
+      uint64_t pos = reduceRange(mix64(key(i), level), size);
+      uint64_t bit = 1ULL << (pos&63);
+      if (__sync_fetch_and_or(&seen[pos>>6], bit) & bit)
+	__sync_fetch_and_or(&collide[pos>>6], bit);
+    }
+  });
+
+  // Positions hit once are assigned; other keys go to next level
+  std::vector<std::vector<objectId_t> > threadLeft(nThreads);
+
+  parallelFor(n, nThreads, [&](uint64_t begin, uint64_t end, unsigned t) {
+    for (uint64_t i=begin; i<end; i++) {
+      objectId_t id = key(i);
+      uint64_t pos = reduceRange(mix64(id, level), size);
+      uint64_t bit = 1ULL << (pos&63);
+      if (collide[pos>>6] & bit) threadLeft[t].push_back(id);
+      else __sync_fetch_and_or(&bits[(start+pos)>>6], bit);
+    }
+  });
+
+  left.clear();
+  for (unsigned t=0; t<nThreads; t++) {
+    left.insert(left.end(), threadLeft[t].begin(), threadLeft[t].end());
+    std::vector<objectId_t>().swap(threadLeft[t]);
+  }
+
+  if (verboseLevel>2) {
+    std::cout << " level " << level << " size " << size << ", "
+	      << left.size() << " keys left" << std::endl;
+  }
+}
+
+
+// Keys colliding at one level are passed to the next level; any left
+// after the last level are stored in an ordinary hash table.  The first
+// level generates the keys; only its collisions (about 40% of keys for
+// gamma=2) are stored.
+
+void PerfectHashIndex::buildHash() {
+  if (gamma < 1.) gamma = 1.;			// Sanity check
+
+  unsigned step = indexStep;
+  std::vector<objectId_t> keys, left;
+  buildLevel(nKeys, [step](uint64_t k) { return k*step; }, keys);
+
+  while (!keys.empty() && levelSize.size() < maxLevels) {
+    buildLevel(keys.size(), [&keys](uint64_t k) { return keys[k]; }, left);
+    keys.swap(left);
+  }
+
+  buildRanks();
+
+  uint64_t placed = nKeys - keys.size();	// Fallbacks take last slots
+  for (size_t i=0; i<keys.size(); i++) {
+    fallback[keys[i]] = placed+i;
+  }
+}
+
+
+// Cumulative count of ones before each block of eight words
+
+void PerfectHashIndex::buildRanks() {
+  blockRank.assign(bits.size()/8 + 1, 0ULL);
+
+  uint64_t ones = 0;
+  for (size_t w=0; w<bits.size(); w++) {
+    if (w%8 == 0) blockRank[w/8] = ones;
+    ones += __builtin_popcountll(bits[w]);
+  }
+}
+
+uint64_t PerfectHashIndex::rank(uint64_t pos) const {
+  uint64_t iword = pos >> 6;
+  uint64_t ones = blockRank[iword/8];
+  for (uint64_t w=iword & ~7ULL; w<iword; w++) {
+    ones += __builtin_popcountll(bits[w]);
+  }
+
+  return ones + __builtin_popcountll(bits[iword] & ((1ULL << (pos&63)) - 1));
+}
+
+
+// First level where key's position is set gives its slot by rank
+
+uint64_t PerfectHashIndex::slot(objectId_t key) const {
+  for (uint64_t level=0; level<levelSize.size(); level++) {
+    uint64_t pos = levelStart[level]
+      + reduceRange(mix64(key, level), levelSize[level]);
+    if ((bits[pos>>6] >> (pos&63)) & 1) return rank(pos);
+  }
+
+  std::unordered_map<objectId_t, uint64_t>::const_iterator fb =
+    fallback.find(key);
+  return (fb != fallback.end()) ? fb->second : nKeys;
+}
+
+uint64_t PerfectHashIndex::fingerprint(objectId_t key) const {
+  return mix64(key, maxLevels) >> (64 - fpBits);   // Independent of levels
+}
+
+
+// Absent keys usually map to some slot; fingerprint rejects them
+
+chunkId_t PerfectHashIndex::value(objectId_t index) {
+  if (nKeys == 0) return 0xdeadbeef;		// Include sanity check
+
+  uint64_t islot = slot(index);
+  if (islot >= nKeys || fingerprints.get(islot) != fingerprint(index))
+    return 0xdeadbeef;
+
+  return chunks.get(islot);
+}
+
+
+// Storage cost per key, for hash function alone and with payload
+
+double PerfectHashIndex::hashBits() const {
+  if (nKeys == 0) return 0.;
+
+  size_t bytes = (bits.size() + blockRank.size())*sizeof(uint64_t)
+    + fallback.size()*(sizeof(objectId_t)+sizeof(uint64_t));
+  return 8.*bytes / nKeys;
+}
+
+double PerfectHashIndex::totalBits() const {
+  if (nKeys == 0) return 0.;
+
+  return hashBits() + 8.*(fingerprints.bytes()+chunks.bytes()) / nKeys;
+}
+
+
+// Append build throughput and bits-per-key to CSV report
+
+void PerfectHashIndex::reportHeadings(std::ostream& csv) const {
+  csv << ", Build Clock (s), Build (Mkeys/s), Threads, Levels"
+      << ", Hash bits/key, Total bits/key";
+}
+
+void PerfectHashIndex::reportColumns(std::ostream& csv) const {
+  double rate = buildUsage.elapsed()>0. ? nKeys/buildUsage.elapsed()/1e6 : 0.;
+
+  csv << ", " << buildUsage.elapsed() << ", " << rate << ", " << nThreads
+      << ", " << levelSize.size() << ", " << hashBits()
+      << ", " << totalBits();
+}
@@ -0,0 +1,76 @@
+#ifndef PERFECT_HASH_INDEX_HH
+#define PERFECT_HASH_INDEX_HH 1
+// $Id$
+// PerfectHashIndex.hh -- Exercise performance of minimal perfect hash
+// function (BBHash style) over static key set as lookup table.  Each key
+// maps to a unique slot in bit-packed fingerprint and chunk arrays.
+//
+// 20261017  Michael Kelsey
+// 20261017  Generate keys for first level, rather than copying key set
+// 20261017  Limit fingerprint width to 1-32 bits
+
+#include "IndexTester.hh"
+#include "ChunkGenerator.hh"
+#include "PackedArray.hh"
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+
+class PerfectHashIndex : public IndexTester {
+public:
+  PerfectHashIndex(int verbose=0);
+  virtual ~PerfectHashIndex() { cleanup(); }
+
+  // Bits per remaining key at each level; larger is faster but bigger
+  void setGamma(double g=2.) { gamma = g; }
+
+  void setThreads(unsigned n=0);		// Zero uses all cores
+  void setFingerprintBits(unsigned bits=8);	// Limited to 1-32
+
+  double hashBits() const;			// Bits per key for MPHF
+  double totalBits() const;			// Including payload
+
+protected:
+  virtual void create(objectId_t asize);
+  virtual chunkId_t value(objectId_t index);
+  virtual void cleanup();
+
+  virtual void reportHeadings(std::ostream& csv) const;
+  virtual void reportColumns(std::ostream& csv) const;
+
+  void buildHash();				// Over generated key set
+
+  // Key source is called as key(k) for k'th key to be placed at level
+  template <class KeySource>
+  void buildLevel(uint64_t n, KeySource key,
+		  std::vector<objectId_t>& left);	// Collisions returned
+  void buildRanks();
+
+  uint64_t slot(objectId_t key) const;		// nKeys if not found
+  uint64_t rank(uint64_t pos) const;		// Ones before position
+
+  uint64_t fingerprint(objectId_t key) const;
+
+  static const unsigned maxLevels = 32;		// Remaining keys to table
+
+private:
+  double gamma;
+  unsigned nThreads;
+  unsigned fpBits;
+  objectId_t nKeys;
+
+  std::vector<uint64_t> bits;			// Concatenated levels
+  std::vector<uint64_t> levelStart;		// First bit of each level
+  std::vector<uint64_t> levelSize;
+  std::vector<uint64_t> blockRank;		// Ones before each 512 bits
+  std::unordered_map<objectId_t, uint64_t> fallback;
+
+  ChunkGenerator chunkGen;
+  PackedArray fingerprints;			// Rejects absent keys
+  PackedArray chunks;
+
+  UsageTimer buildUsage;			// Hash construction alone
+};
+
+#endif	/* PERFECT_HASH_INDEX_HH */
@@ -0,0 +1,307 @@
+// $Id$
+// RemoteIndex.cc -- Exercise performance of another lookup table served
+// by IndexServer in a child process, with pipelined batch requests over a
+// Unix or TCP socket on localhost.
+//
+// 20261017  Michael Kelsey
+
+#include "RemoteIndex.hh"
+#include "IndexServer.hh"
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+
+namespace {
+  // Loop over partial transfers; false on error or closed connection
+
+  bool writeAll(int fd, const void* data, size_t nbytes) {
+    const char* buf = (const char*)data;
+    while (nbytes > 0) {
+      ssize_t n = send(fd, buf, nbytes, MSG_NOSIGNAL);
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) return false;
+      buf += n;
+      nbytes -= n;
+    }
+    return true;
+  }
+
+  bool readAll(int fd, void* data, size_t nbytes) {
+    char* buf = (char*)data;
+    while (nbytes > 0) {
+      ssize_t n = read(fd, buf, nbytes);
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) return false;
+      buf += n;
+      nbytes -= n;
+    }
+    return true;
+  }
+}
+
+
+// Constructor and destructor
+
+RemoteIndex::RemoteIndex(Factory make, Transport trans, int verbose)
+  : IndexTester("remote",verbose), factory(make), transport(trans),
+    server(0), sock(-1), requestKeys(512), depth(8), nRequests(0),
+    nKeys(0) {
+  IndexTester* prototype = factory();		// Only needed for name
+  fullName = (transport == TCP) ? "remote-tcp+" : "remote+";
+  if (prototype) fullName += prototype->GetName();
+  delete prototype;
+  SetName(fullName.c_str());
+
+  std::stringstream where;
+  if (transport == TCP) where << "tcp:127.0.0.1:0";	// Any free port
+  else where << "unix:/tmp/index-server-" << getpid() << ".sock";
+  address = where.str();
+
+  SetBatchSize(4096);			// Single queries are not pipelined
+}
+
+void RemoteIndex::cleanup() {
+  disconnect();
+  killServer();
+}
+
+void RemoteIndex::setPipeline(unsigned keys, unsigned requests) {
+  unsigned maxKeys = IndexServer::maxRequest;
+  requestKeys = (keys > 0) ? std::min(keys, maxKeys) : 1;
+  depth = (requests > 0) ? requests : 1;
+}
+
+
+// Parse transport from name, as "remote" (Unix socket) or "remote-tcp"
+
+bool RemoteIndex::knownTransport(const std::string& name) {
+  return (name == "remote" || name == "remote-tcp");
+}
+
+RemoteIndex::Transport
+RemoteIndex::transportFromName(const std::string& name) {
+  return (name == "remote-tcp") ? TCP : Unix;
+}
+
+
+// Start new server with table of requested size, then connect to it
+
+void RemoteIndex::create(objectId_t asize) {
+  cleanup();				// Discard previous server
+  nRequests = nKeys = 0;
+
+  if (asize == 0) return;
+
+  if (!launchServer(asize)) killServer();
+}
+
+
+// Server builds its table in the child process, then reports on the pipe
+// that it is listening; no need to sleep while the server starts
+
+bool RemoteIndex::launchServer(objectId_t asize) {
+  int ready[2];
+  if (pipe(ready) < 0) {
+    std::cerr << "RemoteIndex unable to create pipe" << std::endl;
+    return false;
+  }
+
+  server = fork();
+  if (server < 0) {
+    std::cerr << "Server creation failed!" << std::endl;
+    server = 0;
+    close(ready[0]);
+    close(ready[1]);
+    return false;
+  }
+
+  if (server == 0) {			// Child process never returns
+    close(ready[0]);
+
+    IndexTester* table = factory();
+    if (table) {
+      table->SetVerboseLevel(verboseLevel);
+      table->SetIndexSpacing(indexStep);
+      table->CreateTable(asize);
+
+      IndexServer service(table, verboseLevel);
+      if (service.listen(address)) {
+	uint64_t status[2] = { table->GetIndexSpacing(), service.port() };
+	bool sent = (write(ready[1], status, sizeof(status)) ==
+		     (ssize_t)sizeof(status));
+	close(ready[1]);
+	if (sent) service.serve();
+      }
+    }
+
+    _exit(0);				// Skip parent's destructors, buffers
+  }
+
+  close(ready[1]);
+
+  uint64_t status[2];
+  bool started = readAll(ready[0], status, sizeof(status));
+  close(ready[0]);
+
+  if (!started) {
+    std::cerr << "RemoteIndex server did not start" << std::endl;
+    return false;
+  }
+
+  if (verboseLevel>1) {
+    std::cout << "RemoteIndex server (PID " << server << ") ready on "
+	      << address << std::endl;
+  }
+
+  SetIndexSpacing(status[0]);		// Table may have forced dense indices
+  return connectServer(status[1]);
+}
+
+bool RemoteIndex::connectServer(unsigned port) {
+  if (transport == TCP) {
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    sock = socket(AF_INET, SOCK_STREAM|SOCK_CLOEXEC, 0);
+    if (sock >= 0 && connect(sock, (sockaddr*)&addr, sizeof(addr)) < 0) {
+      close(sock);
+      sock = -1;
+    }
+
+    int on = 1;
+    if (sock >= 0)
+      setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+  } else {
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, address.c_str()+5, sizeof(addr.sun_path)-1);
+
+    sock = socket(AF_UNIX, SOCK_STREAM|SOCK_CLOEXEC, 0);
+    if (sock >= 0 && connect(sock, (sockaddr*)&addr, sizeof(addr)) < 0) {
+      close(sock);
+      sock = -1;
+    }
+  }
+
+  if (sock < 0) {
+    std::cerr << "RemoteIndex unable to connect to server: "
+	      << strerror(errno) << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+
+// Server does not exit by itself; Unix socket file must be removed here
+
+void RemoteIndex::killServer() {
+  if (server <= 0) return;
+
+  kill(server, SIGTERM);
+  waitpid(server, 0, 0);
+  server = 0;
+
+  if (transport == Unix) unlink(address.c_str()+5);
+}
+
+void RemoteIndex::disconnect() {
+  if (sock >= 0) close(sock);
+  sock = -1;
+  inFlight.clear();
+}
+
+
+// Single query is one round trip
+
+chunkId_t RemoteIndex::value(objectId_t index) {
+  chunkId_t chunk = 0xdeadbeef;
+  if (sendRequest(&index, 1)) readReply(&chunk, 1);
+  return chunk;
+}
+
+// Batch is split into requests, with several in flight at once; replies
+// come back in order
+
+void RemoteIndex::values(const objectId_t* index, chunkId_t* chunk,
+			 size_t n) {
+  size_t sent = 0, done = 0;
+  while (done < n) {
+    while (sent < n && inFlight.size() < depth) {
+      size_t nsend = std::min((size_t)requestKeys, n-sent);
+      if (!sendRequest(index+sent, nsend)) break;
+      sent += nsend;
+    }
+
+    if (inFlight.empty()) break;	// Connection has failed
+
+    size_t nread = inFlight.front();
+    readReply(chunk+done, nread);
+    done += nread;
+  }
+
+  std::fill(chunk+done, chunk+n, 0xdeadbeef);
+}
+
+
+// Request is 32-bit count followed by objectIds, in one write
+
+bool RemoteIndex::sendRequest(const objectId_t* index, size_t n) {
+  if (sock < 0) return false;
+
+  uint32_t count = n;
+  request.resize(sizeof(count) + n*sizeof(objectId_t));
+  memcpy(&request[0], &count, sizeof(count));
+  memcpy(&request[sizeof(count)], index, n*sizeof(objectId_t));
+
+  if (!writeAll(sock, &request[0], request.size())) {
+    std::cerr << "RemoteIndex lost connection to server" << std::endl;
+    disconnect();
+    return false;
+  }
+
+  inFlight.push_back(n);
+  nRequests++;
+  nKeys += n;
+  return true;
+}
+
+bool RemoteIndex::readReply(chunkId_t* chunk, size_t n) {
+  if (sock >= 0 && readAll(sock, chunk, n*sizeof(chunkId_t))) {
+    inFlight.pop_front();
+    return true;
+  }
+
+  std::cerr << "RemoteIndex lost connection to server" << std::endl;
+  std::fill(chunk, chunk+n, 0xdeadbeef);
+  disconnect();
+  return false;
+}
+
+
+// Append protocol configuration and request counts
+
+void RemoteIndex::reportHeadings(std::ostream& csv) const {
+  csv << ", Transport, Pipeline depth, Requests, Keys/request";
+}
+
+void RemoteIndex::reportColumns(std::ostream& csv) const {
+  csv << ", " << (transport == TCP ? "tcp" : "unix") << ", " << depth
+      << ", " << nRequests << ", "
+      << (nRequests>0 ? (double)nKeys/nRequests : 0.);
+}
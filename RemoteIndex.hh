@@ -0,0 +1,69 @@
+#ifndef REMOTE_INDEX_HH
+#define REMOTE_INDEX_HH 1
+// $Id$
+// RemoteIndex.hh -- Exercise performance of another lookup table served
+// by IndexServer in a child process, with pipelined batch requests over a
+// Unix or TCP socket on localhost.
+//
+// 20261017  Michael Kelsey
+
+#include "IndexTester.hh"
+#include <sys/types.h>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+
+class RemoteIndex : public IndexTester {
+public:
+  enum Transport { Unix, TCP };
+
+  // Factory is called in the server process, to build the table there
+  typedef std::function<IndexTester*()> Factory;
+
+  RemoteIndex(Factory factory, Transport transport=Unix, int verbose=0);
+  virtual ~RemoteIndex() { cleanup(); }
+
+  // Keys sent in each request, and requests in flight before waiting
+  void setPipeline(unsigned keys=512, unsigned depth=8);
+
+  static bool knownTransport(const std::string& name);	// "remote", etc.
+  static Transport transportFromName(const std::string& name);
+
+protected:
+  virtual void create(objectId_t asize);
+  virtual chunkId_t value(objectId_t index);
+  virtual void values(const objectId_t* index, chunkId_t* chunk, size_t n);
+  virtual void cleanup();
+
+  virtual void reportHeadings(std::ostream& csv) const;
+  virtual void reportColumns(std::ostream& csv) const;
+
+  bool launchServer(objectId_t asize);	// Returns when server is ready
+  bool connectServer(unsigned port);
+  void killServer();
+  void disconnect();
+
+  bool sendRequest(const objectId_t* index, size_t n);
+  bool readReply(chunkId_t* chunk, size_t n);
+
+private:
+  Factory factory;
+  Transport transport;
+  std::string address;			// For IndexServer::listen()
+  std::string fullName;
+
+  pid_t server;
+  int sock;
+
+  unsigned requestKeys;
+  unsigned depth;
+  std::deque<size_t> inFlight;		// Keys in each unanswered request
+  std::vector<char> request;
+
+  long nRequests;
+  long nKeys;
+};
+
+#endif	/* REMOTE_INDEX_HH */
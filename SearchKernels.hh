@@ -0,0 +1,67 @@
+#ifndef SEARCH_KERNELS_HH
+#define SEARCH_KERNELS_HH 1
+// $Id$
+// SearchKernels.hh -- Inline search functions over sorted arrays of
+// objectIds, shared by the sorted-array style lookup tables.
+//
+// 20261017  Michael Kelsey
+
+#include "IndexTester.hh"
+
+
+// Branch-free lower bound: returns position of first key >= x (n if none)
+
+inline objectId_t branchlessLowerBound(const objectId_t* keys, objectId_t n,
+				       objectId_t x) {
+  if (n == 0) return 0;
+
+  const objectId_t* base = keys;
+  while (n > 1) {
+    objectId_t half = n/2;
+    base = (base[half-1] < x) ? base+half : base;	// Compiles to cmov
+    n -= half;
+  }
+
+  return (base-keys) + (*base < x);
+}
+
+
+// Eytzinger (BFS) layout lower bound; keys are 1-indexed, keys[0] unused.
+// Returns Eytzinger position of first key >= x, or 0 if there is none.
+
+inline objectId_t eytzingerLowerBound(const objectId_t* keys, objectId_t n,
+				      objectId_t x, bool prefetch=true) {
+  objectId_t k = 1;
+  while (k <= n) {
+    if (prefetch) __builtin_prefetch(keys + 8*k);	// Three levels ahead
+    k = 2*k + (keys[k] < x);
+  }
+
+  return k >> __builtin_ffsll(~k);	// Undo the final right turns
+}
+
+
+// Interpolation search, for nearly uniform spacing of keys.  After
+// "maxSteps" guesses the remaining range is finished by binary search.
+// Returns position of first key >= x, or n if there is none.
+
+inline objectId_t interpolationLowerBound(const objectId_t* keys, objectId_t n,
+					  objectId_t x, int maxSteps=4) {
+  if (n == 0 || x <= keys[0]) return 0;
+  if (x > keys[n-1]) return n;
+
+  objectId_t lo = 0, hi = n-1;		// Invariant: keys[lo] < x <= keys[hi]
+  for (int step=0; step<maxSteps && hi-lo > 1; step++) {
+    double frac = (double)(x-keys[lo]) / (double)(keys[hi]-keys[lo]);
+    objectId_t guess = lo + (objectId_t)(frac*(hi-lo));
+    if (guess <= lo) guess = lo+1;
+    if (guess >= hi) guess = hi-1;
+
+    if (keys[guess] < x) lo = guess;
+    else hi = guess;
+  }
+
+  return lo+1 + branchlessLowerBound(keys+lo+1, hi-lo-1, x);
+}
+
+#endif	/* SEARCH_KERNELS_HH */
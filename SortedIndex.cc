@@ -0,0 +1,187 @@
+// $Id$
+// SortedIndex.cc -- Exercise performance of sorted key and chunk arrays
+// as lookup table, with a choice of search kernels.
+//
+// 20261017  Michael Kelsey
+// 20261017  Optional bit-packed chunks, sized from generated chunk range
+// 20261017  Reuse batch position buffer
+// 20261017  Match kernel as any '-' separated word of type string
+
+#include "SortedIndex.hh"
+#include "SearchKernels.hh"
+#include <string.h>
+#include <iostream>
+
+
+// Constructor and destructor
+
+SortedIndex::SortedIndex(int verbose)
+  : IndexTester("sorted",verbose), kernel(Binary), prefetch(true),
+    packed(false), nKeys(0ULL), keys(0), chunks(0), typeName("sorted") {;}
+
+void SortedIndex::cleanup() {
+  delete[] keys;
+  keys = 0;
+  delete[] chunks;
+  chunks = 0;
+  packedChunks.clear();
+  nKeys = 0;
+}
+
+
+// Select search kernel; CSV name is changed to match
+
+void SortedIndex::setKernel(Kernel kern) {
+  kernel = kern;
+  updateName();
+}
+
+void SortedIndex::setPacked(bool pack) {
+  packed = pack;
+  updateName();
+}
+
+void SortedIndex::updateName() {
+  switch (kernel) {
+  case Eytzinger:     typeName = "sorted-eytzinger"; break;
+  case Interpolation: typeName = "sorted-interp"; break;
+  default:            typeName = "sorted"; break;
+  }
+
+  if (packed) typeName += "-packed";
+  SetName(typeName.c_str());
+}
+
+SortedIndex::Kernel SortedIndex::kernelFromName(const char* type) {
+  if (!type) return Binary;
+
+  // Each word may be in any order, e.g. "sorted-packed-interp"
+  for (const char* word=type; word; word=strchr(word, '-')) {
+    if (*word == '-') word++;
+    size_t len = strcspn(word, "-");
+    if (len == 9 && strncmp(word, "eytzinger", len) == 0) return Eytzinger;
+    if (len == 6 && strncmp(word, "interp", len) == 0) return Interpolation;
+  }
+
+  return Binary;
+}
+
+
+// Populate arrays with full range of keys, all values zero
+
+void SortedIndex::create(objectId_t asize) {
+  if (keys) cleanup();			// Avoid memory leaks
+  if (asize == 0) return;
+
+  nKeys = asize;
+  objectId_t nSlots = (kernel == Eytzinger) ? nKeys+1 : nKeys;
+
+  // Packed chunks come from generator, in key order; otherwise zeroes
+  if (packed) {
+    chunkGen.reset();
+    packedChunks.resize(nSlots, PackedArray::bitsFor(chunkGen.maxChunk()));
+  } else {
+    chunks = new chunkId_t[nSlots]();
+  }
+
+  keys = new objectId_t[nSlots];
+  if (kernel == Eytzinger) {
+    keys[0] = 0ULL;			// Unused slot for 1-indexing
+    fillEytzinger(0, 1);
+  } else {
+    fillSorted();
+  }
+
+  if (verboseLevel>1) {
+    std::cout << "SortedIndex filled " << nKeys << " keys, "
+	      << bytes()/1e6 << " MB" << std::endl;
+  }
+}
+
+void SortedIndex::fillSorted() {
+  for (objectId_t i=0; i<nKeys; i++) {
+    keys[i] = i*indexStep;
+    setChunk(i);
+  }
+}
+
+void SortedIndex::setChunk(objectId_t pos) {
+  if (packed) packedChunks.set(pos, chunkGen.next());
+}
+
+size_t SortedIndex::bytes() const {
+  size_t nSlots = (kernel == Eytzinger) ? nKeys+1 : nKeys;
+  return nSlots*sizeof(objectId_t) +
+    (packed ? packedChunks.bytes() : nSlots*sizeof(chunkId_t));
+}
+
+// In-order traversal of the implicit tree assigns keys in ascending order
+
+objectId_t SortedIndex::fillEytzinger(objectId_t isort, objectId_t k) {
+  if (k <= nKeys) {
+    isort = fillEytzinger(isort, 2*k);
+    keys[k] = isort*indexStep;
+    setChunk(k);
+    isort++;
+    isort = fillEytzinger(isort, 2*k+1);
+  }
+
+  return isort;
+}
+
+
+// Locate slot of index in keys array, or ~0 if index was not registered
+
+objectId_t SortedIndex::position(objectId_t index) const {
+  if (!keys) return ~0ULL;		// Include sanity check
+
+  objectId_t pos = 0;
+  switch (kernel) {
+  case Eytzinger:
+    pos = eytzingerLowerBound(keys, nKeys, index, prefetch);
+    return (pos != 0 && keys[pos] == index) ? pos : ~0ULL;
+  case Interpolation:
+    pos = interpolationLowerBound(keys, nKeys, index); break;
+  default:
+    pos = branchlessLowerBound(keys, nKeys, index); break;
+  }
+
+  return (pos < nKeys && keys[pos] == index) ? pos : ~0ULL;
+}
+
+
+// Return chunk only if index was registered
+
+chunkId_t SortedIndex::value(objectId_t index) {
+  objectId_t pos = position(index);
+  if (pos == ~0ULL) return 0xdeadbeef;
+
+  return packed ? packedChunks.get(pos) : chunks[pos];
+}
+
+// Search for whole batch first, then decode packed chunks together
+
+void SortedIndex::values(const objectId_t* index, chunkId_t* chunk,
+			 size_t n) {
+  if (!packed) {
+    for (size_t i=0; i<n; i++) chunk[i] = value(index[i]);
+    return;
+  }
+
+  if (batchPos.size() < n) batchPos.resize(n);
+  for (size_t i=0; i<n; i++) batchPos[i] = position(index[i]);
+
+  packedChunks.gather(batchPos.data(), n, chunk, 0xdeadbeef);
+}
+
+
+// Append storage per entry
+
+void SortedIndex::reportHeadings(std::ostream& csv) const {
+  csv << ", Chunk bits, Bytes/entry";
+}
+
+void SortedIndex::reportColumns(std::ostream& csv) const {
+  csv << ", " << (packed ? packedChunks.width() : 8*sizeof(chunkId_t))
+      << ", " << (nKeys>0 ? (double)bytes()/nKeys : 0.);
+}
@@ -0,0 +1,67 @@
+#ifndef SORTED_INDEX_HH
+#define SORTED_INDEX_HH 1
+// $Id$
+// SortedIndex.hh -- Exercise performance of sorted key and chunk arrays
+// as lookup table, with a choice of search kernels.
+//
+// 20261017  Michael Kelsey
+// 20261017  Optional bit-packed chunks, sized from generated chunk range
+// 20261017  Reuse batch position buffer
+// 20261017  Match kernel as any '-' separated word of type string
+
+#include "IndexTester.hh"
+#include "ChunkGenerator.hh"
+#include "PackedArray.hh"
+#include <string>
+#include <vector>
+
+
+class SortedIndex : public IndexTester {
+public:
+  enum Kernel { Binary, Eytzinger, Interpolation };
+
+  SortedIndex(int verbose=0);
+  virtual ~SortedIndex() { cleanup(); }
+
+  // Select search kernel; CSV name is changed to match
+  void setKernel(Kernel kern);
+  Kernel getKernel() const { return kernel; }
+
+  void setPrefetch(bool pf=true) { prefetch = pf; }	// Eytzinger only
+  void setPacked(bool pack=true);			// Changes CSV name
+
+  // Parse kernel from type string, e.g., "sorted-packed-eytzinger" or
+  // "interp"; default is binary search
+  static Kernel kernelFromName(const char* type);
+
+protected:
+  virtual void create(objectId_t asize);
+  virtual chunkId_t value(objectId_t index);
+  virtual void values(const objectId_t* index, chunkId_t* chunk, size_t n);
+  virtual void cleanup();
+
+  virtual void reportHeadings(std::ostream& csv) const;
+  virtual void reportColumns(std::ostream& csv) const;
+
+  void updateName();
+  void fillSorted();			// Keys in ascending order
+  objectId_t fillEytzinger(objectId_t isort, objectId_t k);   // Recursive
+  void setChunk(objectId_t pos);	// Next chunk, if packing
+
+  objectId_t position(objectId_t index) const;	// ~0 if not found
+  size_t bytes() const;				// Keys and chunks
+
+private:
+  Kernel kernel;
+  bool prefetch;
+  bool packed;
+  objectId_t nKeys;
+  objectId_t* keys;			// Eytzinger layout is 1-indexed
+  chunkId_t* chunks;
+  PackedArray packedChunks;		// Used instead of chunks if packing
+  ChunkGenerator chunkGen;
+  std::vector<objectId_t> batchPos;	// Positions for packed batch lookup
+  std::string typeName;
+};
+
+#endif	/* SORTED_INDEX_HH */
@@ -7,6 +7,7 @@
 // 20151023  Michael Kelsey
 // 20151026  Add access to memory usage (multiply by ticks)
 // 20151114  Replace clock_t with timeval to get wall-clock duration
+// 20261017  Add access to minor (reclaim) page faults
 
 #include <time.h>
 #include <sys/time.h>
@@ -49,6 +50,7 @@ public:
   double memoryData() const { return (double)uTotal.ru_idrss/elapsed(); }
   double memoryStack() const { return (double)uTotal.ru_isrss/elapsed(); }
   long pageFaults() const { return uTotal.ru_majflt; }
+  long minorFaults() const { return uTotal.ru_minflt; }
   long swaps() const { return uTotal.ru_nswap; }
   long ioInput() const { return uTotal.ru_inblock; }
   long ioOutput() const { return uTotal.ru_oublock; }
@@ -1,6 +1,6 @@
 // $Id$
-// XrootdSimple.cc -- Exercise performance of XRootD providing flat files
-//		      as blocked lookup tables, 100M entries per file.
+// XrootdSimple.cc -- Exercise performance of XRootD providing sorted
+//		      block files as lookup tables, 10M entries per file.
 //
 // 20151103  Michael Kelsey
 // 20151113  Fix server configs per Andy H., move all temp files into data dir
@@ -8,6 +8,8 @@
 // 20151116  Remove debugging option from XRootD services.
 // 20160217  Suppress sparse indexing for now, requires invasive changes
 // 20160224  Move destructor action to cleanup() function
+// 20261017  Keep pool of open files (LRU); asynchronous reads for batches
+// 20261017  Sparse block files with key directory; vector reads per file
 
 #include "XrootdSimple.hh"
 #include "XrdCl/XrdClFile.hh"
@@ -19,18 +21,94 @@
 #include <errno.h>
 #include <signal.h>
 #include <unistd.h>
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <string>
 using namespace std;
 
 
+// Vector read of blocks from one file, for the lookups in those blocks.
+// Blocks are searched in the XrdCl thread, writing directly into the
+// output array, then completion is signalled to the table.
+
+class XrootdSimple::ReadRequest : public XrdCl::ResponseHandler {
+public:
+  ReadRequest(XrootdSimple* table) : owner(table), index(0), chunk(0) {;}
+  virtual ~ReadRequest() {;}
+
+  void reset(const objectId_t* idx, chunkId_t* chk) {
+    index = idx;
+    chunk = chk;
+    offsets.clear();
+    lookups.clear();
+  }
+
+  // Lookups must be added in order of block offset
+  void add(size_t i, uint64_t offset) {
+    if (offsets.empty() || offsets.back() != offset) offsets.push_back(offset);
+    lookups.push_back(std::make_pair(i, offsets.size()-1));
+  }
+
+  size_t size() const { return offsets.size(); }
+
+  // New block would exceed the XRootD limit on a single vector read
+  bool full(uint64_t offset) const {
+    return (offsets.size() == maxVectorBlocks && offsets.back() != offset);
+  }
+
+  const XrdCl::ChunkList& chunks() {
+    blocks.resize(offsets.size());
+    reads.clear();
+    for (size_t ib=0; ib<offsets.size(); ib++) {
+      reads.push_back(XrdCl::ChunkInfo(offsets[ib], BlockFile::blockBytes,
+				       &blocks[ib]));
+    }
+    return reads;
+  }
+
+  virtual void HandleResponse(XrdCl::XRootDStatus* status,
+			      XrdCl::AnyObject* response) {
+    XrdCl::VectorReadInfo* info = 0;
+    if (status->IsOK() && response) response->Get(info);
+    bool ok = (info && info->GetSize() == blocks.size()*BlockFile::blockBytes);
+
+    for (size_t il=0; il<lookups.size(); il++) {
+      size_t i = lookups[il].first;
+      chunk[i] = ok ? BlockFile::find(blocks[lookups[il].second], index[i])
+	: 0xdeadbeef;
+    }
+
+    delete status;
+    delete response;
+    owner->readDone();
+  }
+
+  void fail() {				// Request was not sent
+    for (size_t il=0; il<lookups.size(); il++)
+      chunk[lookups[il].first] = 0xdeadbeef;
+    owner->readDone();
+  }
+
+private:
+  XrootdSimple* owner;
+  const objectId_t* index;
+  chunkId_t* chunk;
+  std::vector<uint64_t> offsets;		// Distinct blocks to read
+  std::vector<std::pair<size_t, size_t> > lookups;	// Batch entry, block
+  std::vector<BlockFile::Block> blocks;
+  XrdCl::ChunkList reads;
+};
+
+
 // Constructor and destructor
 
 XrootdSimple::XrootdSimple(int verbose)
-  : IndexTester("xrootd", verbose), entriesPerFile(10000000),
+  : IndexTester("xrootd", verbose), entriesPerFile(10000000), nFiles(0),
     dirName("/tmp/xrootd_simple"), xrdConfigName("xrootd.conf"),
-    xrdServerPid(0), cmsdServerPid(0), xrdManagerPid(0), cmsdManagerPid(0) {
+    xrdServerPid(0), cmsdServerPid(0), xrdManagerPid(0), cmsdManagerPid(0),
+    maxOpenFiles(64), nOpens(0), directoryBytes(0), nRequests(0),
+    nVectorReads(0), nBlockReads(0), inFlight(0), maxInFlight(256) {
   const size_t namelen = sysconf(_SC_HOST_NAME_MAX)+1;
   char hostname[namelen];
   gethostname(hostname, namelen);
@@ -39,9 +117,12 @@ XrootdSimple::XrootdSimple(int verbose)
 
 XrootdSimple::~XrootdSimple() {
   cleanup();
+
+  for (size_t i=0; i<requests.size(); i++) delete requests[i];
 }
 
 void XrootdSimple::cleanup() {
+  closeFiles();			// Must be done while services are running
   killServer();
   killManager();
   //*** deleteTempFiles();	// Do we really want to do this?
@@ -51,16 +132,18 @@ void XrootdSimple::cleanup() {
 // Interface to base class for constructing and accessing servers
 
 void XrootdSimple::create(objectId_t asize) {
-  SetIndexSpacing(1);		// Override user request for sparse indices
-
   if (verboseLevel) cout << "XrootdSimple::create " << asize << endl;
 
+  closeFiles();
+  nOpens = nVectorReads = nBlockReads = 0;
+  directoryBytes = 0;
+
   if (!writeXrdConfigFile()) {
     cerr << "Unable to create XRootD configuration file!" << endl;
     ::exit(1);
   }
 
-  if (!createTempFiles(asize/entriesPerFile+1)) {
+  if (!createTempFiles((asize+entriesPerFile-1)/entriesPerFile)) {
     cerr << "Index file creation failed!" << endl;
     ::exit(1);
   }
@@ -73,43 +156,246 @@ void XrootdSimple::create(objectId_t asize) {
   sleep(10);		// Wait for services to be ready for access
 }
 
+
+// Key directory locates block in memory; one block is read per lookup
+
 chunkId_t XrootdSimple::value(objectId_t index) { 
   if (verboseLevel>1) cout << "XrootdSimple::value " << index << endl;
 
-  size_t ifile = index / entriesPerFile;
-  size_t offset = index % entriesPerFile * sizeof(int);
+  size_t ifile = index / keysPerFile();
+  if (ifile >= nFiles) return 0xdeadbeef;
+
+  OpenFile* blockFile = getFile(ifile);
+  if (!blockFile) return -1;
+
+  int64_t iblock = BlockFile::locate(blockFile->fences.data(),
+				     blockFile->fences.size(),
+				     blockFile->maxKey, index);
+  if (iblock < 0) return 0xdeadbeef;
+
+  uint64_t offset = iblock*BlockFile::blockBytes;
+  if (verboseLevel>2) cout << "... reading at offset " << offset << endl;
+
+  uint32_t readLen = 0;
+  nBlockReads++;
+  if (!blockFile->file->Read(offset, BlockFile::blockBytes, &block,
+			     readLen).IsOK()) {
+    cerr << "Unable to read " << getXrdPath(ifile) << " at offset " << offset
+	 << endl;
+    return -1;
+  }
+
+  if (readLen != BlockFile::blockBytes) return 0xdeadbeef;
+  return BlockFile::find(block, index);
+}
+
+
+// Lookups in a batch are sorted, so that all of the blocks needed from
+// each file are fetched with vector reads, up to maxInFlight at once
+
+void XrootdSimple::values(const objectId_t* index, chunkId_t* chunk,
+			  size_t n) {
+  order.resize(n);
+  for (size_t i=0; i<n; i++) order[i] = i;
+  std::sort(order.begin(), order.end(),
+	    [index](size_t a, size_t b) { return index[a] < index[b]; });
+
+  nRequests = 0;
+  size_t next = 0;
+  while (next < n) {
+    size_t ifile = index[order[next]] / keysPerFile();
+    size_t last = next;			// End of lookups in this file
+    while (last < n && index[order[last]] / keysPerFile() == ifile) last++;
+
+    OpenFile* blockFile = (ifile < nFiles) ? getFile(ifile) : 0;
+
+    ReadRequest* request = 0;
+    for (; next < last; next++) {
+      size_t i = order[next];
+      int64_t iblock = -1;
+      if (blockFile) {
+	iblock = BlockFile::locate(blockFile->fences.data(),
+				   blockFile->fences.size(),
+				   blockFile->maxKey, index[i]);
+      }
+
+      if (iblock < 0) {
+	chunk[i] = 0xdeadbeef;
+	continue;
+      }
+
+      uint64_t offset = iblock*BlockFile::blockBytes;
+      if (request && request->full(offset)) {
+	issueRead(blockFile, request);
+	request = 0;
+      }
+
+      if (!request) request = nextRequest(index, chunk);
+      request->add(i, offset);
+    }
+
+    if (request) issueRead(blockFile, request);
+  }
+
+  waitForReads(0);
+}
+
+XrootdSimple::ReadRequest*
+XrootdSimple::nextRequest(const objectId_t* index, chunkId_t* chunk) {
+  if (nRequests == requests.size()) requests.push_back(new ReadRequest(this));
+
+  ReadRequest* request = requests[nRequests++];
+  request->reset(index, chunk);
+  return request;
+}
+
+void XrootdSimple::issueRead(OpenFile* blockFile, ReadRequest* request) {
+  waitForReads(maxInFlight-1);
+  {
+    std::lock_guard<std::mutex> guard(readLock);
+    inFlight++;
+  }
+
+  nVectorReads++;
+  nBlockReads += request->size();
+
+  if (verboseLevel>2) {
+    cout << "... reading " << request->size() << " blocks from "
+	 << getXrdPath(blockFile->ifile) << endl;
+  }
+
+  if (!blockFile->file->VectorRead(request->chunks(), 0, request).IsOK())
+    request->fail();
+}
+
+void XrootdSimple::readDone() {
+  std::lock_guard<std::mutex> guard(readLock);
+  inFlight--;
+  readSignal.notify_all();
+}
+
+void XrootdSimple::waitForReads(size_t limit) {
+  std::unique_lock<std::mutex> guard(readLock);
+  while (inFlight > limit) readSignal.wait(guard);
+}
 
-  string xrdFile = dirName+"/"+getTempFilename(ifile);
-  string xrdPath = localHostName+":10940/"+xrdFile;
 
+// Find file in pool, or open it, closing least recently used if needed
+
+XrootdSimple::OpenFile* XrootdSimple::getFile(size_t ifile) {
+  std::map<size_t, FileList::iterator>::iterator found = fileIndex.find(ifile);
+  if (found != fileIndex.end()) {
+    openFiles.splice(openFiles.begin(), openFiles, found->second);
+    return &openFiles.front();
+  }
+
+  if (openFiles.size() >= maxOpenFiles) {
+    waitForReads(0);			// Oldest file may have reads pending
+
+    if (verboseLevel>2)
+      cout << "... closing file " << openFiles.back().ifile << endl;
+
+    openFiles.back().file->Close();
+    delete openFiles.back().file;
+    fileIndex.erase(openFiles.back().ifile);
+    openFiles.pop_back();
+  }
+
+  string xrdPath = getXrdPath(ifile);
   if (verboseLevel>2) cout << "... accessing " << xrdPath << endl;
 
-  XrdCl::File blockFile;
-  if (!blockFile.Open(xrdPath,XrdCl::OpenFlags::Read).IsOK()) {
+  XrdCl::File* blockFile = new XrdCl::File;
+  if (!blockFile->Open(xrdPath,XrdCl::OpenFlags::Read).IsOK()) {
     cerr << "Unable to access " << xrdPath << endl;
-    return -1;
+    delete blockFile;
+    return 0;
   }
 
-  if (verboseLevel>2) cout << "... reading at offset " << offset << endl;
+  nOpens++;
+  openFiles.push_front(OpenFile());
+  openFiles.front().ifile = ifile;
+  openFiles.front().file = blockFile;
+
+  if (!loadDirectory(openFiles.front())) {
+    cerr << "Unable to read key directory from " << xrdPath << endl;
+    blockFile->Close();
+    delete blockFile;
+    openFiles.pop_front();
+    return 0;
+  }
+
+  fileIndex[ifile] = openFiles.begin();
+  return &openFiles.front();
+}
+
+// Fence pointers and footer are at end of file (see BlockFile)
+
+bool XrootdSimple::loadDirectory(OpenFile& open) {
+  XrdCl::StatInfo* info = 0;
+  if (!open.file->Stat(false, info).IsOK() || !info) return false;
+  uint64_t fileSize = info->GetSize();
+  delete info;
 
-  chunkId_t readValue = 0;			// Input buffer from XRD
+  BlockFile::Footer foot;
   uint32_t readLen = 0;
-  if (!blockFile.Read(offset, sizeof(chunkId_t), &readValue, readLen).IsOK()) {
-    cerr << "Unable to read " << xrdPath << " at offset " << offset << endl;
-    return -1;
+  if (fileSize < sizeof(foot) ||
+      !open.file->Read(fileSize-sizeof(foot), sizeof(foot), &foot,
+		       readLen).IsOK() ||
+      readLen != sizeof(foot) || foot.magic != BlockFile::fileMagic) {
+    return false;
+  }
+
+  uint32_t nbytes = foot.nBlocks*sizeof(objectId_t);
+  open.fences.resize(foot.nBlocks);
+  open.maxKey = foot.maxKey;
+  if (nbytes > 0 &&
+      (!open.file->Read(foot.nBlocks*BlockFile::blockBytes, nbytes,
+			open.fences.data(), readLen).IsOK() ||
+       readLen != nbytes)) {
+    return false;
   }
 
-  if (verboseLevel>2) cout << "... closing file" << endl;
+  directoryBytes += nbytes + sizeof(foot);
+  if (verboseLevel>2)
+    cout << "... " << foot.nBlocks << " blocks in file " << open.ifile << endl;
+
+  return true;
+}
+
+void XrootdSimple::closeFiles() {
+  waitForReads(0);
 
-  if (!blockFile.Close().IsOK()) {
-    cerr << "Unable to properly close " << xrdPath << endl;
+  for (FileList::iterator f=openFiles.begin(); f!=openFiles.end(); ++f) {
+    if (!f->file->Close().IsOK())
+      cerr << "Unable to properly close " << getXrdPath(f->ifile) << endl;
+    delete f->file;
   }
 
-  return readValue;
+  openFiles.clear();
+  fileIndex.clear();
 }
 
+string XrootdSimple::getXrdPath(size_t ifile) {
+  return localHostName+":10940/"+dirName+"/"+getTempFilename(ifile);
+}
+
+
+// Append file pool and read statistics
 
-// Create flat files locally (before XRootD starts) for lookup tables
+void XrootdSimple::reportHeadings(std::ostream& csv) const {
+  csv << ", Open file limit, File opens, Directory (bytes), Reads in flight"
+      << ", Vector reads, Blocks/read";
+}
+
+void XrootdSimple::reportColumns(std::ostream& csv) const {
+  csv << ", " << maxOpenFiles << ", " << nOpens << ", " << directoryBytes
+      << ", " << (batchSize>1 ? maxInFlight : 1) << ", " << nVectorReads
+      << ", " << (nVectorReads>0 ? (double)nBlockReads/nVectorReads : 0.);
+}
+
+
+// Create block files locally (before XRootD starts) for lookup tables;
+// each file holds entriesPerFile consecutive (sparse) objectIds
 
 bool XrootdSimple::createTempFiles(size_t nfiles) {
   if (verboseLevel>1) {
@@ -117,8 +403,11 @@ bool XrootdSimple::createTempFiles(size_t nfiles) {
 	 << endl;
   }
 
+  nFiles = 0;
+  chunkGen.reset();
   for (size_t ifile=0; ifile<nfiles; ifile++) {
     if (!createTempFile(ifile)) return false;	// Abandon if file fails
+    nFiles++;
   }
 
   return true;
@@ -127,17 +416,17 @@ bool XrootdSimple::createTempFiles(size_t nfiles) {
 bool XrootdSimple::createTempFile(size_t ifile) {
   string fname = dirName+"/"+getTempFilename(ifile);
 
-  // FIXME:  We should be creating actual lookup files!
-  static const int zero=0;		// Passed to fwrite as pointer
+  objectId_t first = ifile*entriesPerFile;
+  objectId_t last = std::min(first+entriesPerFile, tableSize);
 
-  FILE* outf = fopen(fname.c_str(), "w");
-  for (size_t i=0; i<entriesPerFile; i++) {
-    fwrite(&zero,sizeof(int),1,outf);
-  }
+  BlockFile blocks;
+  if (!blocks.create(fname)) return false;
 
-  fclose(outf);		// Close and reopen for future access
+  for (objectId_t i=first; i<last; i++) {
+    if (!blocks.append(i*indexStep, chunkGen.next())) return false;
+  }
 
-  return true;
+  return blocks.finish();
 }
 
 
@@ -1,16 +1,27 @@
 #ifndef XROOTD_SIMPLE_HH
 #define XROOTD_SIMPLE_HH 1
 // $Id$
-// XrootdSimple.hh -- Exercise performance of XRootD providing flat files
-//		      as blocked lookup tables.
+// XrootdSimple.hh -- Exercise performance of XRootD providing sorted
+//		      block files (see BlockFile) as lookup tables.
 //
 // 20151103  Michael Kelsey
 // 20151113  Add buffer for local hostname, used in configuring XRootD
 // 20160224  Move destructor action to cleanup() function
+// 20261017  Keep pool of open files (LRU); asynchronous reads for batches
+// 20261017  Sparse block files with key directory; vector reads per file
 
 #include "IndexTester.hh"
+#include "BlockFile.hh"
+#include "ChunkGenerator.hh"
 #include <sys/types.h>
+#include <condition_variable>
+#include <list>
+#include <map>
+#include <mutex>
 #include <string>
+#include <vector>
+
+namespace XrdCl { class File; }
 
 
 class XrootdSimple : public IndexTester {
@@ -18,10 +29,41 @@ public:
   XrootdSimple(int verbose=0);
   virtual ~XrootdSimple();
 
+  // Files kept open between lookups, and vector reads in flight for batches
+  void setOpenFiles(size_t n=64) { maxOpenFiles = (n>0) ? n : 1; }
+  void setReadsInFlight(size_t n=256) { maxInFlight = (n>0) ? n : 1; }
+
+  static const size_t maxVectorBlocks = 1024;	// XRootD limit per readv
+
 protected:
   virtual void create(objectId_t asize);
   virtual void cleanup();
   virtual chunkId_t value(objectId_t index);
+  virtual void values(const objectId_t* index, chunkId_t* chunk, size_t n);
+
+  virtual void reportHeadings(std::ostream& csv) const;
+  virtual void reportColumns(std::ostream& csv) const;
+
+  // Open file, with key directory (fence pointers) read from its trailer
+  struct OpenFile {
+    size_t ifile;
+    XrdCl::File* file;
+    std::vector<objectId_t> fences;	// First key of each block
+    objectId_t maxKey;
+  };
+
+  OpenFile* getFile(size_t ifile);	// Opens file if not in pool
+  bool loadDirectory(OpenFile& open);
+  void closeFiles();
+  std::string getXrdPath(size_t ifile);
+  objectId_t keysPerFile() const { return entriesPerFile*indexStep; }
+
+  // Vector reads signal completion here, from XrdCl threads
+  class ReadRequest;
+  ReadRequest* nextRequest(const objectId_t* index, chunkId_t* chunk);
+  void issueRead(OpenFile* file, ReadRequest* request);
+  void readDone();
+  void waitForReads(size_t limit);	// Until no more than limit in flight
 
   bool createTempFiles(size_t nfiles);
   bool writeXrdConfigFile();
@@ -35,12 +77,14 @@ protected:
   bool createTempDir();		// Create temporary directory if necessary
 
   std::string getTempFilename(size_t ifile);	// Generate index filename
-  bool createTempFile(size_t ifile);
+  bool createTempFile(size_t ifile);		// Sorted block file
   pid_t launchService(const char* svcExec, const char* svcName);
   void killService(pid_t& svcPid);		// Pass-by-value to set to zero
 
 private:
-  size_t entriesPerFile;	// Number of index entries per flat file
+  size_t entriesPerFile;	// Number of index entries per block file
+  size_t nFiles;
+  ChunkGenerator chunkGen;
   std::string localHostName;	// Name of host, to pass to XRootD services
   std::string dirName;		// Directory path to hold flat files
   std::string xrdConfigName;	// Configuration file for XRootD services
@@ -49,6 +93,26 @@ private:
   pid_t cmsdServerPid;
   pid_t xrdManagerPid;
   pid_t cmsdManagerPid;
+
+  // Open files, most recently used at front of list
+  typedef std::list<OpenFile> FileList;
+  FileList openFiles;
+  std::map<size_t, FileList::iterator> fileIndex;
+  size_t maxOpenFiles;
+  long nOpens;
+  uint64_t directoryBytes;		// Fence pointers read over XRootD
+
+  BlockFile::Block block;		// Buffer for single lookups
+  std::vector<size_t> order;		// Batch positions sorted by objectId
+  std::vector<ReadRequest*> requests;	// Vector reads, reused
+  size_t nRequests;			// Used in current batch
+  long nVectorReads;
+  long nBlockReads;
+
+  std::mutex readLock;
+  std::condition_variable readSignal;
+  size_t inFlight;
+  size_t maxInFlight;
 };
 
 #endif	/* XROOTD_SIMPLE_HH */
@@ -0,0 +1,31 @@
+#include "ArtIndex.hh"
+#include <stdlib.h>
+#include <iostream>
+
+
+// Get command line arguments for array size (100M) and number of trials (1M)
+void arrayArgs(int argc, char* argv[], objectId_t& asize, int& reps) {
+  asize = (argc>1) ? strtoull(argv[1], 0, 0) : 100000000;
+  reps  = (argc>2) ? strtol(argv[2], 0, 0)   : 1000000;
+}
+
+
+// Main program goes here; optional third argument is bulk update file
+
+int main(int argc, char* argv[]) {
+  objectId_t arraySize;
+  int queryTrials;
+  arrayArgs(argc, argv, arraySize, queryTrials);
+
+  std::cout << "Adaptive radix tree " << arraySize << " elements, "
+	    << queryTrials << " trials" << std::endl;
+
+  ArtIndex art(2);			// Verbosity
+  art.SetIndexSpacing(10);		// Keys as produced by randomIndex()
+  art.CreateTable(arraySize);
+  if (argc>3) art.UpdateTable(argv[3]);
+  art.ExerciseTable(queryTrials);
+
+  std::cout << "Storage " << art.bytesPerEntry() << " bytes/entry"
+	    << std::endl;
+}
@@ -0,0 +1,41 @@
+#include "BTreeIndex.hh"
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+
+
+// Get command line arguments for array size (100M) and number of trials (1M)
+void arrayArgs(int argc, char* argv[], objectId_t& asize, int& reps) {
+  asize = (argc>1) ? strtoull(argv[1], 0, 0) : 100000000;
+  reps  = (argc>2) ? strtol(argv[2], 0, 0)   : 1000000;
+}
+
+
+// Run test with specified node size
+
+template <int B>
+void runTest(objectId_t arraySize, int queryTrials, bool prefetch) {
+  std::cout << "Static B+ tree (" << B << " keys/node) " << arraySize
+	    << " elements, " << queryTrials << " trials" << std::endl;
+
+  BTreeIndex<B> btree(2);		// Verbosity
+  btree.setPrefetch(prefetch);
+  btree.SetIndexSpacing(10);		// Keys as produced by randomIndex()
+  btree.CreateTable(arraySize);
+  btree.ExerciseTable(queryTrials);
+}
+
+
+// Main program goes here; optional third argument "8" selects small
+// nodes, fourth argument "prefetch" enables per-level prefetching
+
+int main(int argc, char* argv[]) {
+  objectId_t arraySize;
+  int queryTrials;
+  arrayArgs(argc, argv, arraySize, queryTrials);
+
+  bool prefetch = (argc>4 && strcmp(argv[4], "prefetch")==0);
+
+  if (argc>3 && atoi(argv[3])==8) runTest<8>(arraySize, queryTrials, prefetch);
+  else runTest<16>(arraySize, queryTrials, prefetch);
+}
@@ -0,0 +1,30 @@
+#include "DiskBlockIndex.hh"
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+
+
+// Get command line arguments for array size (100M) and number of trials (1M)
+void arrayArgs(int argc, char* argv[], objectId_t& asize, int& reps) {
+  asize = (argc>1) ? strtoull(argv[1], 0, 0) : 100000000;
+  reps  = (argc>2) ? strtol(argv[2], 0, 0)   : 1000000;
+}
+
+
+// Main program goes here; optional third argument "direct" uses O_DIRECT
+
+int main(int argc, char* argv[]) {
+  objectId_t arraySize;
+  int queryTrials;
+  arrayArgs(argc, argv, arraySize, queryTrials);
+
+  std::cout << "Block file " << arraySize << " elements, " << queryTrials
+	    << " trials" << std::endl;
+
+  DiskBlockIndex blocks(2);		// Verbosity
+  if (argc>3) blocks.setDirect(strcmp(argv[3], "direct") == 0);
+
+  blocks.SetIndexSpacing(10);		// Keys as produced by randomIndex()
+  blocks.CreateTable(arraySize);
+  blocks.ExerciseTable(queryTrials);
+}
@@ -13,7 +13,8 @@ void arrayArgs(int argc, char* argv[], objectId_t& asize, int& reps) {
 }
 
 
-// Main program goes here
+// Main program goes here; optional third argument is access mode, and
+// fourth is number of queries per batch
 
 int main(int argc, char* argv[]) {
   objectId_t arraySize;
@@ -24,6 +25,8 @@ int main(int argc, char* argv[]) {
 	    << " trials" << std::endl;
 
   FileIndex afile(1);		// Verbosity
+  if (argc>3) afile.configure(argv[3]);
+  if (argc>4) afile.SetBatchSize(strtoul(argv[4], 0, 0));
   afile.CreateTable(arraySize);
   afile.ExerciseTable(queryTrials);
 }
@@ -0,0 +1,32 @@
+#include "HashIndex.hh"
+#include <stdlib.h>
+#include <iostream>
+
+
+// Get command line arguments for array size (100M) and number of trials (1M)
+void arrayArgs(int argc, char* argv[], objectId_t& asize, int& reps) {
+  asize = (argc>1) ? strtoull(argv[1], 0, 0) : 100000000;
+  reps  = (argc>2) ? strtol(argv[2], 0, 0)   : 1000000;
+}
+
+
+// Main program goes here; optional third argument is load factor
+
+int main(int argc, char* argv[]) {
+  objectId_t arraySize;
+  int queryTrials;
+  arrayArgs(argc, argv, arraySize, queryTrials);
+
+  std::cout << "Hash table " << arraySize << " elements, " << queryTrials
+	    << " trials" << std::endl;
+
+  HashIndex hash(1);			// Verbosity
+  if (argc>3) hash.setLoadFactor(strtod(argv[3], 0));
+
+  hash.SetIndexSpacing(10);		// Keys as produced by randomIndex()
+  hash.CreateTable(arraySize);
+  hash.ExerciseTable(queryTrials);
+
+  std::cout << "Storage " << hash.bytesPerEntry() << " bytes/entry"
+	    << std::endl;
+}
@@ -1,6 +1,7 @@
 // $Id$
 //
-// Usage: index-performance <type> [minsize=100M] [maxsize=100B] > <CSV-file>
+// Usage: index-performance <type> [minsize=100M] [maxsize=100B] [missfrac=0]
+//			     [batch=1]
 //
 // Measure performance of objectID/chuck indexing options over a range
 // of index sizes, both initial filling and for 1M random queries.
@@ -8,6 +9,8 @@
 // 30x, up to (and including) the maximum size.
 //
 // The range of jobs can be omitted, and will default to 100M to 100B.
+// A fraction of the queries (missfrac) may be for absent objectIds, and
+// queries may be passed to the index in batches.
 //
 // Results of each test will be written to standard output as comma
 // separated values (CSV).  The output may be redirected to a text file
@@ -16,16 +19,60 @@
 // There are four different indexing options ([type]) currently defined:
 //
 // array	Simple C-style array of ints
+// art		Adaptive radix tree, supporting inserts
 // blocks	Set of separately allocated 1M int C-style arrays
+// diskblock	Sorted 4 KiB blocks in file, one read per lookup (-direct
+//		suffix uses O_DIRECT)
+// btree16	Static B+ tree, 16 keys per node (btree8 for 8 keys per node,
+//		-prefetch suffix enables per-level prefetching)
+// hash		Open-addressing hash table with SIMD-probed control tags
+// interval	Run-length intervals of objectIds clustered by chunk
+// learned	Two-stage learned model over sorted arrays
+// lsm		Log-structured merge tree on disk, with background compaction
+//		(lsm-mixed replaces half of the queries with writes)
 // stdmap	Use std::map<> as key-value index
+// sorted	Sorted arrays of keys and chunks, branch-free binary search
+//		(sorted-eytzinger, sorted-interp select other search kernels)
+// eliasfano	Elias-Fano compressed key set, bit-packed chunk numbers
 // file		Binary file storing ints; index is offset into file
+//		(file-mmap uses mmap(), with options -random, -willneed,
+//		-huge for madvise(), -populate and -lock for preloading;
+//		file-uring uses batched io_uring reads, with options
+//		-direct for O_DIRECT and -fixed for registered buffers)
 // memcached	Key-value pairs registered to a Memcached server
-// xrootd	Binary files storing ints, accessed via XRootD
+//		(memcached-bulk loads with buffered sets from 4 threads)
+// mphf		Minimal perfect hash with fingerprints, bit-packed chunks
+// xrootd	Sorted block files, accessed via XRootD (vector reads
+//		for batches)
 // rocksdb	Key-value pairs registered to a RocksDB instance
 // mysql	True database system, using same technology as QServ
+//		(mysql-prepared uses prepared statements, binary results;
+//		batches use IN-lists, or temporary table joins if large;
+//		mysql-parallel loads tables on 4 connections at once)
 // umysql	Database system, with bulk update in place of queries
 //
-// The type may be specified by the first character, if desired.
+// The type may be specified by the first character, if desired, except
+// for "sorted", "btree" and "lsm" (two characters), "art" (three characters),
+// and their variants.
+//
+// The array, blocks and btree types may have a page policy suffix, "-thp"
+// (transparent huge pages), "-huge2m" or "-huge1g" (explicit huge pages,
+// which must be reserved by the system administrator), or "-small".
+//
+// The array, blocks and sorted types may have a "-packed" suffix, to store
+// generated chunk numbers in bit-packed arrays, using only as many bits
+// as the largest chunk number needs.
+//
+// Any type may be prefixed with "bloom+" or "xor+" to put an approximate
+// membership filter in front of the table, rejecting absent objectIds.
+//
+// In-memory types may be prefixed with "replicate+" (copy of table on each
+// NUMA node) or "partition+" (objectId range split among nodes), with a
+// query thread pinned to each node; batches default to 4096 queries.
+//
+// Any type may be prefixed with "remote+" or "remote-tcp+" to serve the
+// table from a child process (see IndexServer), over a Unix or localhost
+// TCP socket; batches default to 4096 queries, pipelined in requests.
 
 // 20151024  Michael Kelsey
 // 20151028  Add std::map<> option
@@ -33,24 +80,30 @@
 // 20151125  Add RocksDB option, use preprocessor macro
 // 20160119  Add MySQL with InnoDB option
 // 20160217  Add MySQL with bulk-updating test instead of queries
-
-#include "ArrayIndex.hh"
-#include "BlockArrays.hh"
-#include "MapIndex.hh"
-#include "FileIndex.hh"
-#ifdef HAS_MEMCACHED
-#include "MemCDIndex.hh"
-#endif
-#ifdef HAS_XROOTD
-#include "XrootdSimple.hh"
-#endif
-#ifdef HAS_ROCKSDB
-#include "RocksIndex.hh"
-#endif
-#ifdef HAS_MYSQL
-#include "MysqlIndex.hh"
-#include "MysqlUpdate.hh"
-#endif
+// 20261017  Add sorted-array option with selectable search kernels
+// 20261017  Add open-addressing hash table option
+// 20261017  Add learned index option
+// 20261017  Add chunk-interval option
+// 20261017  Add memory-mapped options for flat file
+// 20261017  Add static B+ tree option
+// 20261017  Add Elias-Fano compressed option
+// 20261017  Add minimal perfect hash option
+// 20261017  Add Bloom and xor filter prefixes, fraction of absent queries
+// 20261017  Add adaptive radix tree option
+// 20261017  Add batch size argument
+// 20261017  Add sorted block file option
+// 20261017  Add log-structured merge tree option
+// 20261017  Add page policy suffixes for in-memory arrays
+// 20261017  Add NUMA replicated and partitioned prefixes
+// 20261017  Add -packed suffix for array, blocks and sorted
+// 20261017  Move getTester() to IndexFactory.cc, add remote prefixes
+// 20261017  Add memcached bulk loading option
+// 20261017  XRootD table uses sparse block files
+// 20261017  Add mysql-prepared option
+// 20261017  MySQL supports batched lookups
+// 20261017  Add mysql-parallel option
+
+#include "IndexFactory.hh"
 #include <stdlib.h>
 #include <cmath>
 #include <fstream>
@@ -63,50 +116,6 @@ using namespace std;
 
 typedef objectId_t ULL;
 
-// Get testing driver based on type name
-
-IndexTester* getTester(const string& type) {
-  switch (type[0]) {
-  case 'a': return new ArrayIndex; break;
-  case 'b': return new BlockArrays; break;
-  case 'f': return new FileIndex; break;
-  case 'm':
-    switch (type[1]) {
-#ifdef HAS_MEMCACHED
-    case 'e': return new MemCDIndex; break;
-#endif
-#ifdef HAS_MYSQL
-    case 'y': {
-      MysqlIndex* mysql = new MysqlIndex;
-      mysql->setTableSize(40e6);
-      return mysql;
-    } break;
-#endif
-    default: break;
-    } break;
-#ifdef HAS_ROCKSDB
-  case 'r': return new RocksIndex; break;
-#endif
-  case 's': return new MapIndex; break;
-#ifdef HAS_MYSQL
-  case 'u': {
-    MysqlUpdate* umysql = new MysqlUpdate;
-    umysql->setTableSize(4e6);		// Small blocks to test bulk split
-    return umysql;
-  } break;
-#endif
-#ifdef HAS_XROOTD
-  case 'x': return new XrootdSimple; break;
-#endif
-  default: break;
-  }
-
-  // Falls through if nothing matched
-  cerr << "ERROR: unknown indexing type " << type << endl;
-  return 0;
-}
-
-
 // Do logarithmic stepping (1 -> 3, 3 -> 10) of size
 
 ULL NextSizeStep(ULL asize) {
@@ -121,7 +130,7 @@ ULL NextSizeStep(ULL asize) {
 // Performance testing
 
 int main(int argc, char* argv[]) {
-  // Get command line arguments: type, minsize, maxsize
+  // Get command line arguments: type, minsize, maxsize, missfrac, batch
   if (argc<2) {
     cerr << "ERROR: indexing type must be specified" << endl;
     ::exit(1);
@@ -130,6 +139,7 @@ int main(int argc, char* argv[]) {
   string type = argv[1];
   ULL minsize = (argc>2) ? strtoull(argv[2],0,0) : 100000000;
   ULL maxsize = (argc>3) ? strtoull(argv[3],0,0) : 100000000000;
+  double missfrac = (argc>4) ? strtod(argv[4],0) : 0.;
 
   const long trials = 1000000;		// Might make this an argument later
 
@@ -138,6 +148,8 @@ int main(int argc, char* argv[]) {
   if (!tester) ::exit(2);
 
   tester->SetIndexSpacing(10);		// Sparsify objectIDs where possible
+  tester->SetMissFraction(missfrac);
+  if (argc>5) tester->SetBatchSize(strtoul(argv[5],0,0));
 
   string csvName = tester->GetName();	// Set up comma-separated data
   csvName += ".csv";
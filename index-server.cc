@@ -0,0 +1,66 @@
+// $Id$
+//
+// Usage: index-server <type> [size=100M]
+//		       [address=unix:/tmp/index-server.sock] [spacing=10]
+//
+// Build lookup table of given type and size (types as for
+// index-performance), then serve objectId to chunk lookups on the
+// address ("unix:<path>", "tcp:<port>" or "tcp:<host>:<port>") until
+// interrupted.  Requests are batches of N objectIds, with a 32-bit N
+// prefix; replies are N chunkIds (see IndexServer.hh).
+//
+// 20261017  Michael Kelsey
+
+#include "IndexFactory.hh"
+#include "IndexServer.hh"
+#include <signal.h>
+#include <stdlib.h>
+#include <iostream>
+#include <string>
+using namespace std;
+
+
+// Interrupt stops server, so that Unix socket file is removed
+
+IndexServer* server = 0;
+
+void stopServer(int) {
+  if (server) server->stop();
+}
+
+
+int main(int argc, char* argv[]) {
+  if (argc<2) {
+    cerr << "ERROR: indexing type must be specified" << endl;
+    ::exit(1);
+  }
+
+  string type = argv[1];
+  objectId_t asize = (argc>2) ? strtoull(argv[2],0,0) : 100000000;
+  string address = (argc>3) ? argv[3] : "unix:/tmp/index-server.sock";
+  unsigned spacing = (argc>4) ? strtoul(argv[4],0,0) : 10;
+
+  IndexTester* table = getTester(type);
+  if (!table) ::exit(2);
+
+  table->SetVerboseLevel(1);
+  table->SetIndexSpacing(spacing);
+  table->CreateTable(asize);
+
+  server = new IndexServer(table, 2);		// Verbosity
+  if (!server->listen(address)) ::exit(3);
+
+  signal(SIGINT, stopServer);
+  signal(SIGTERM, stopServer);
+
+  cout << table->GetName() << " " << asize << " objectIds (spacing "
+       << table->GetIndexSpacing() << ") on " << address << endl;
+
+  server->serve();
+
+  cout << server->requests() << " requests, " << server->lookups()
+       << " lookups" << endl;
+
+  delete server;
+  delete table;
+}
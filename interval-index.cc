@@ -0,0 +1,34 @@
+#include "IntervalIndex.hh"
+#include <stdlib.h>
+#include <iostream>
+
+
+// Get command line arguments for array size (100M) and number of trials (1M)
+void arrayArgs(int argc, char* argv[], objectId_t& asize, int& reps) {
+  asize = (argc>1) ? strtoull(argv[1], 0, 0) : 100000000;
+  reps  = (argc>2) ? strtol(argv[2], 0, 0)   : 1000000;
+}
+
+
+// Main program goes here; optional arguments are mean run length and
+// fraction of straggler objects
+
+int main(int argc, char* argv[]) {
+  objectId_t arraySize;
+  int queryTrials;
+  arrayArgs(argc, argv, arraySize, queryTrials);
+
+  std::cout << "Chunk intervals " << arraySize << " elements, " << queryTrials
+	    << " trials" << std::endl;
+
+  IntervalIndex intervals(2);		// Verbosity
+  if (argc>4) intervals.setClustering(strtoull(argv[3], 0, 0),
+				      strtod(argv[4], 0));
+
+  intervals.SetIndexSpacing(10);	// Keys as produced by randomIndex()
+  intervals.CreateTable(arraySize);
+  intervals.ExerciseTable(queryTrials);
+
+  std::cout << "Storage " << intervals.bytesPerEntry() << " bytes/entry"
+	    << std::endl;
+}
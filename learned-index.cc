@@ -0,0 +1,29 @@
+#include "LearnedIndex.hh"
+#include <stdlib.h>
+#include <iostream>
+
+
+// Get command line arguments for array size (100M) and number of trials (1M)
+void arrayArgs(int argc, char* argv[], objectId_t& asize, int& reps) {
+  asize = (argc>1) ? strtoull(argv[1], 0, 0) : 100000000;
+  reps  = (argc>2) ? strtol(argv[2], 0, 0)   : 1000000;
+}
+
+
+// Main program goes here; optional third argument is keys per segment
+
+int main(int argc, char* argv[]) {
+  objectId_t arraySize;
+  int queryTrials;
+  arrayArgs(argc, argv, arraySize, queryTrials);
+
+  std::cout << "Learned index " << arraySize << " elements, " << queryTrials
+	    << " trials" << std::endl;
+
+  LearnedIndex learned(2);		// Verbosity
+  if (argc>3) learned.setSegmentSize(strtoull(argv[3], 0, 0));
+
+  learned.SetIndexSpacing(10);		// Keys as produced by randomIndex()
+  learned.CreateTable(arraySize);
+  learned.ExerciseTable(queryTrials);
+}
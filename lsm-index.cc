@@ -0,0 +1,31 @@
+#include "LsmIndex.hh"
+#include <stdlib.h>
+#include <iostream>
+
+
+// Get command line arguments for array size (100M) and number of trials (1M)
+void arrayArgs(int argc, char* argv[], objectId_t& asize, int& reps) {
+  asize = (argc>1) ? strtoull(argv[1], 0, 0) : 100000000;
+  reps  = (argc>2) ? strtol(argv[2], 0, 0)   : 1000000;
+}
+
+
+// Main program goes here; optional third argument is fraction of writes
+// mixed with queries, and fourth is bulk update file
+
+int main(int argc, char* argv[]) {
+  objectId_t arraySize;
+  int queryTrials;
+  arrayArgs(argc, argv, arraySize, queryTrials);
+
+  std::cout << "LSM tree " << arraySize << " elements, " << queryTrials
+	    << " trials" << std::endl;
+
+  LsmIndex lsm(2);			// Verbosity
+  if (argc>3) lsm.setWriteFraction(strtod(argv[3], 0));
+
+  lsm.SetIndexSpacing(10);		// Keys as produced by randomIndex()
+  lsm.CreateTable(arraySize);
+  if (argc>4) lsm.UpdateTable(argv[4]);
+  lsm.ExerciseTable(queryTrials);
+}
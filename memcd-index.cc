@@ -10,7 +10,8 @@ void arrayArgs(int argc, char* argv[], objectId_t& asize, int& reps) {
 }
 
 
-// Main program goes here
+// Main program goes here; optional third argument is number of queries
+// per multi-get batch, and fourth is number of bulk loading threads
 
 int main(int argc, char* argv[]) {
   objectId_t arraySize;
@@ -21,6 +22,8 @@ int main(int argc, char* argv[]) {
 	    << " trials" << std::endl;
 
   MemCDIndex memcd(2);		// Verbosity
+  if (argc>3) memcd.SetBatchSize(strtoul(argv[3], 0, 0));
+  if (argc>4) memcd.setBulkLoad(strtol(argv[4], 0, 0));
   memcd.CreateTable(arraySize);
   memcd.ExerciseTable(queryTrials);
 }
@@ -0,0 +1,29 @@
+#include "PerfectHashIndex.hh"
+#include <stdlib.h>
+#include <iostream>
+
+
+// Get command line arguments for array size (100M) and number of trials (1M)
+void arrayArgs(int argc, char* argv[], objectId_t& asize, int& reps) {
+  asize = (argc>1) ? strtoull(argv[1], 0, 0) : 100000000;
+  reps  = (argc>2) ? strtol(argv[2], 0, 0)   : 1000000;
+}
+
+
+// Main program goes here; optional third argument is number of threads
+
+int main(int argc, char* argv[]) {
+  objectId_t arraySize;
+  int queryTrials;
+  arrayArgs(argc, argv, arraySize, queryTrials);
+
+  std::cout << "Minimal perfect hash " << arraySize << " elements, "
+	    << queryTrials << " trials" << std::endl;
+
+  PerfectHashIndex mphf(3);		// Verbosity
+  if (argc>3) mphf.setThreads(strtoul(argv[3], 0, 0));
+
+  mphf.SetIndexSpacing(10);		// Keys as produced by randomIndex()
+  mphf.CreateTable(arraySize);
+  mphf.ExerciseTable(queryTrials);
+}
@@ -10,7 +10,9 @@ void arrayArgs(int argc, char* argv[], objectId_t& asize, int& reps) {
 }
 
 
-// Main program goes here
+// Main program goes here; optional third argument (non-zero) selects
+// lookups with prepared statements, fourth is number of queries per batch,
+// fifth is number of threads (connections) for loading tables
 
 int main(int argc, char* argv[]) {
   objectId_t arraySize;
@@ -22,6 +24,9 @@ int main(int argc, char* argv[]) {
 
   MysqlIndex theDB(2);		// Verbosity
   theDB.setTableSize(40e6);	// Use smaller blocks of data for efficiency
+  if (argc>3) theDB.setPrepared(strtol(argv[3], 0, 0) != 0);
+  if (argc>4) theDB.SetBatchSize(strtoul(argv[4], 0, 0));
+  if (argc>5) theDB.setParallelLoad(strtol(argv[5], 0, 0));
 
   theDB.CreateTable(arraySize);
   theDB.ExerciseTable(queryTrials);
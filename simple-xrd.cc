@@ -10,7 +10,8 @@ void arrayArgs(int argc, char* argv[], objectId_t& asize, int& reps) {
 }
 
 
-// Main program goes here
+// Main program goes here; optional third argument is number of queries
+// per batch, read asynchronously
 
 int main(int argc, char* argv[]) {
   objectId_t arraySize;
@@ -21,6 +22,7 @@ int main(int argc, char* argv[]) {
 	    << " trials" << std::endl;
 
   XrootdSimple xrdidx(3);		// Verbosity
+  if (argc>3) xrdidx.SetBatchSize(strtoul(argv[3], 0, 0));
   xrdidx.CreateTable(arraySize);
   xrdidx.ExerciseTable(queryTrials);
 }
@@ -0,0 +1,29 @@
+#include "SortedIndex.hh"
+#include <stdlib.h>
+#include <iostream>
+
+
+// Get command line arguments for array size (100M) and number of trials (1M)
+void arrayArgs(int argc, char* argv[], objectId_t& asize, int& reps) {
+  asize = (argc>1) ? strtoull(argv[1], 0, 0) : 100000000;
+  reps  = (argc>2) ? strtol(argv[2], 0, 0)   : 1000000;
+}
+
+
+// Main program goes here; optional third argument selects search kernel
+
+int main(int argc, char* argv[]) {
+  objectId_t arraySize;
+  int queryTrials;
+  arrayArgs(argc, argv, arraySize, queryTrials);
+
+  SortedIndex sorted(1);		// Verbosity
+  sorted.setKernel(SortedIndex::kernelFromName(argc>3 ? argv[3] : 0));
+
+  std::cout << "Sorted array (" << sorted.GetName() << ") " << arraySize
+	    << " elements, " << queryTrials << " trials" << std::endl;
+
+  sorted.SetIndexSpacing(10);		// Exercise sparse key search
+  sorted.CreateTable(arraySize);
+  sorted.ExerciseTable(queryTrials);
+}